@@ -0,0 +1,525 @@
+#pragma once
+
+#include "schema.hpp"
+
+// Apache Arrow C Data Interface structures, as fixed by the specification.
+// The guard is the one the specification prescribes so these definitions
+// coexist with Arrow's own headers.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C"
+{
+  struct ArrowSchema
+  {
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+    void (*release)(struct ArrowSchema *);
+    void *private_data;
+  };
+
+  struct ArrowArray
+  {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+    void (*release)(struct ArrowArray *);
+    void *private_data;
+  };
+}
+
+#endif
+
+namespace binary_serializer
+{
+
+namespace arrow_detail
+{
+
+// Arrow format strings for scalar and string fields; arrays have no flat
+// Arrow equivalent here and are rejected.
+inline const char *format_of(field_type type)
+{
+  switch (type)
+  {
+  case field_type::boolean:
+    return "b";
+  case field_type::int8:
+    return "c";
+  case field_type::uint8:
+    return "C";
+  case field_type::int16:
+    return "s";
+  case field_type::uint16:
+    return "S";
+  case field_type::int32:
+    return "i";
+  case field_type::uint32:
+    return "I";
+  case field_type::int64:
+    return "l";
+  case field_type::uint64:
+    return "L";
+  case field_type::float32:
+    return "f";
+  case field_type::float64:
+    return "g";
+  case field_type::string:
+    return "u";
+  default:
+    throw std::invalid_argument("Array fields have no Arrow column form");
+  }
+}
+
+inline field_type type_of(std::string_view format)
+{
+  for (field_type type :
+       {field_type::boolean, field_type::int8, field_type::uint8,
+        field_type::int16, field_type::uint16, field_type::int32,
+        field_type::uint32, field_type::int64, field_type::uint64,
+        field_type::float32, field_type::float64, field_type::string})
+  {
+    if (format == format_of(type))
+    {
+      return type;
+    }
+  }
+  throw std::invalid_argument("Unsupported Arrow column format");
+}
+
+// Column storage in Arrow's physical layout, so export hands out pointers
+// to it directly: values in native byte order, booleans as an LSB-first
+// bitmap, strings as int32 offsets plus concatenated UTF-8 bytes.
+struct column
+{
+  std::vector<uint8_t> values;
+  std::vector<int32_t> offsets{0};
+};
+
+using column_set = std::vector<column>;
+
+struct schema_holder
+{
+  std::string format;
+  std::string name;
+  std::vector<ArrowSchema> children;
+  std::vector<ArrowSchema *> child_pointers;
+};
+
+// Keeps the exported columns alive until the consumer releases the array,
+// independently of the batch that produced them.
+struct array_holder
+{
+  std::shared_ptr<const column_set> columns;
+  std::array<const void *, 3> buffers{};
+  std::vector<ArrowArray> children;
+  std::vector<ArrowArray *> child_pointers;
+};
+
+inline void release_schema(ArrowSchema *schema)
+{
+  auto *holder = static_cast<schema_holder *>(schema->private_data);
+  for (ArrowSchema &child : holder->children)
+  {
+    if (child.release)
+      child.release(&child);
+  }
+  delete holder;
+  schema->release = nullptr;
+}
+
+inline void release_array(ArrowArray *array)
+{
+  auto *holder = static_cast<array_holder *>(array->private_data);
+  for (ArrowArray &child : holder->children)
+  {
+    if (child.release)
+      child.release(&child);
+  }
+  delete holder;
+  array->release = nullptr;
+}
+
+inline void set_bit(std::vector<uint8_t> &bitmap, size_t index, bool value)
+{
+  if (index / 8 >= bitmap.size())
+    bitmap.push_back(0);
+  if (value)
+    bitmap[index / 8] |= static_cast<uint8_t>(1u << (index % 8));
+}
+
+inline bool get_bit(const uint8_t *bitmap, size_t index)
+{
+  return (bitmap[index / 8] >> (index % 8)) & 1;
+}
+
+} // namespace arrow_detail
+
+// Columnar form of a run of schema records (scalar and string fields only),
+// exchangeable with Arrow through the C Data Interface. Export is zero-copy:
+// the Arrow buffers point at the batch's own storage, which stays alive
+// until the consumer releases it even if the batch is destroyed first.
+class ColumnBatch
+{
+private:
+  Schema m_schema;
+  std::shared_ptr<arrow_detail::column_set> m_columns;
+  size_t m_rows = 0;
+
+public:
+  explicit ColumnBatch(const Schema &schema)
+      : m_schema(schema),
+        m_columns(std::make_shared<arrow_detail::column_set>(schema.size()))
+  {
+    if (schema.size() == 0)
+    {
+      throw std::invalid_argument("Cannot build columns for an empty schema");
+    }
+    for (const field &f : schema.fields())
+    {
+      arrow_detail::format_of(f.type);
+    }
+  }
+
+  // Decodes back-to-back records into columns.
+  static ColumnBatch from_records(byte_view records, const Schema &schema,
+                                  endianness endian = endianness::native)
+  {
+    ColumnBatch batch(schema);
+    batch.append_records(records, endian);
+    return batch;
+  }
+
+  void append_records(byte_view records, endianness endian = endianness::native)
+  {
+    arrow_detail::column_set &columns = writable_columns();
+    Deserializer in(records, endian);
+    try
+    {
+      while (in.has_more())
+      {
+        for (size_t i = 0; i < m_schema.size(); ++i)
+        {
+          append_field(in, m_schema[i].type, columns[i]);
+        }
+        ++m_rows;
+      }
+    }
+    catch (...)
+    {
+      truncate_to_rows(columns);
+      throw;
+    }
+  }
+
+  // Encodes the batch back into back-to-back records.
+  std::vector<uint8_t> to_records(endianness endian = endianness::native) const
+  {
+    Serializer out(endian);
+    for (size_t row = 0; row < m_rows; ++row)
+    {
+      for (size_t i = 0; i < m_schema.size(); ++i)
+      {
+        const field_type type = m_schema[i].type;
+        if (type == field_type::string)
+        {
+          out << std::string(string_at(i, row));
+        }
+        else if (type == field_type::boolean)
+        {
+          out << bool_at(i, row);
+        }
+        else
+        {
+          visit_scalar(type, [&](auto tag) {
+            using T = typename decltype(tag)::type;
+            if constexpr (!std::is_same_v<T, bool>)
+              out << values<T>(i)[row];
+          });
+        }
+      }
+    }
+    return out.get_data();
+  }
+
+  const Schema &schema() const
+  {
+    return m_schema;
+  }
+  size_t num_rows() const
+  {
+    return m_rows;
+  }
+
+  // Contiguous values of a fixed-width, non-boolean column; T must be the
+  // column's exact C++ type.
+  template <typename T> const T *values(size_t column) const
+  {
+    static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>,
+                  "Use bool_at for boolean columns");
+    const field_type type = m_schema[column].type;
+    bool matches = false;
+    if (type != field_type::string)
+    {
+      visit_scalar(type, [&](auto tag) {
+        matches = std::is_same_v<typename decltype(tag)::type, T>;
+      });
+    }
+    if (!matches)
+    {
+      throw std::invalid_argument("Column type mismatch");
+    }
+    return reinterpret_cast<const T *>((*m_columns)[column].values.data());
+  }
+
+  bool bool_at(size_t column, size_t row) const
+  {
+    return arrow_detail::get_bit((*m_columns)[column].values.data(), row);
+  }
+
+  std::string_view string_at(size_t column, size_t row) const
+  {
+    const arrow_detail::column &c = (*m_columns)[column];
+    return std::string_view(
+        reinterpret_cast<const char *>(c.values.data()) + c.offsets[row],
+        static_cast<size_t>(c.offsets[row + 1] - c.offsets[row]));
+  }
+
+  // Fills `array` and `schema` with a struct array whose children are the
+  // columns; the caller owns both and must call their release callbacks.
+  void export_to(ArrowArray *array, ArrowSchema *schema) const
+  {
+    const size_t count = m_schema.size();
+
+    auto *schema_data = new arrow_detail::schema_holder{"+s", "", {}, {}};
+    schema_data->children.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      auto *child_data = new arrow_detail::schema_holder{
+          arrow_detail::format_of(m_schema[i].type), m_schema[i].name, {}, {}};
+      schema_data->children[i] =
+          ArrowSchema{child_data->format.c_str(), child_data->name.c_str(),
+                      nullptr, 0, 0, nullptr, nullptr,
+                      &arrow_detail::release_schema, child_data};
+      schema_data->child_pointers.push_back(&schema_data->children[i]);
+    }
+    *schema = ArrowSchema{schema_data->format.c_str(),
+                          schema_data->name.c_str(),
+                          nullptr,
+                          0,
+                          static_cast<int64_t>(count),
+                          schema_data->child_pointers.data(),
+                          nullptr,
+                          &arrow_detail::release_schema,
+                          schema_data};
+
+    auto *array_data = new arrow_detail::array_holder{m_columns, {}, {}, {}};
+    array_data->children.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const arrow_detail::column &c = (*m_columns)[i];
+      auto *child_data =
+          new arrow_detail::array_holder{m_columns, {}, {}, {}};
+      int64_t buffer_count = 2;
+      if (m_schema[i].type == field_type::string)
+      {
+        child_data->buffers = {nullptr, c.offsets.data(), c.values.data()};
+        buffer_count = 3;
+      }
+      else
+      {
+        child_data->buffers = {nullptr, c.values.data(), nullptr};
+      }
+      array_data->children[i] =
+          ArrowArray{static_cast<int64_t>(m_rows), 0, 0, buffer_count, 0,
+                     child_data->buffers.data(), nullptr, nullptr,
+                     &arrow_detail::release_array, child_data};
+      array_data->child_pointers.push_back(&array_data->children[i]);
+    }
+    *array = ArrowArray{static_cast<int64_t>(m_rows),
+                        0,
+                        0,
+                        1,
+                        static_cast<int64_t>(count),
+                        array_data->buffers.data(),
+                        array_data->child_pointers.data(),
+                        nullptr,
+                        &arrow_detail::release_array,
+                        array_data};
+  }
+
+  // Copies a struct array of scalar and string columns without nulls, then
+  // releases both structures as the interface requires of a consumer.
+  static ColumnBatch import_from(ArrowArray *array, ArrowSchema *schema)
+  {
+    struct release_guard
+    {
+      ArrowArray *array;
+      ArrowSchema *schema;
+      ~release_guard()
+      {
+        if (array->release)
+          array->release(array);
+        if (schema->release)
+          schema->release(schema);
+      }
+    } guard{array, schema};
+
+    if (std::string_view(schema->format) != "+s" ||
+        array->n_children != schema->n_children)
+    {
+      throw std::invalid_argument("Arrow import expects a struct array");
+    }
+
+    Schema imported;
+    for (int64_t i = 0; i < schema->n_children; ++i)
+    {
+      const ArrowSchema *child = schema->children[i];
+      imported.add(child->name ? child->name : "",
+                   arrow_detail::type_of(child->format));
+    }
+
+    ColumnBatch batch(imported);
+    batch.m_rows = static_cast<size_t>(array->length);
+    for (size_t i = 0; i < imported.size(); ++i)
+    {
+      const ArrowArray *child = array->children[i];
+      if (child->null_count != 0 && child->buffers[0] != nullptr)
+      {
+        throw std::invalid_argument("Arrow import does not support nulls");
+      }
+      if (child->length < array->offset + array->length)
+      {
+        throw std::invalid_argument("Arrow child shorter than its parent");
+      }
+      const bool is_string = imported[i].type == field_type::string;
+      if (child->n_buffers != (is_string ? 3 : 2) || !child->buffers ||
+          !child->buffers[1] || (is_string && !child->buffers[2]))
+      {
+        throw std::invalid_argument("Arrow child has missing buffers");
+      }
+      import_column(*child, static_cast<size_t>(array->offset),
+                    batch.m_rows, imported[i].type, (*batch.m_columns)[i]);
+    }
+    return batch;
+  }
+
+private:
+  // Drops anything a failed record appended past the last complete row, so
+  // every column keeps exactly m_rows entries.
+  void truncate_to_rows(arrow_detail::column_set &columns)
+  {
+    for (size_t i = 0; i < m_schema.size(); ++i)
+    {
+      arrow_detail::column &c = columns[i];
+      const field_type type = m_schema[i].type;
+      if (type == field_type::string)
+      {
+        c.offsets.resize(m_rows + 1);
+        c.values.resize(static_cast<size_t>(c.offsets.back()));
+      }
+      else if (type == field_type::boolean)
+      {
+        c.values.resize((m_rows + 7) / 8);
+        if (m_rows % 8 != 0)
+          c.values.back() &= static_cast<uint8_t>((1u << (m_rows % 8)) - 1);
+      }
+      else
+      {
+        c.values.resize(m_rows * fixed_width(type));
+      }
+    }
+  }
+
+  // Copy-on-write: exported columns are never modified underneath a
+  // consumer.
+  arrow_detail::column_set &writable_columns()
+  {
+    if (m_columns.use_count() > 1)
+    {
+      m_columns = std::make_shared<arrow_detail::column_set>(*m_columns);
+    }
+    return *m_columns;
+  }
+
+  void append_field(Deserializer &in, field_type type, arrow_detail::column &c)
+  {
+    if (type == field_type::string)
+    {
+      std::string_view value;
+      in >> value;
+      c.values.insert(c.values.end(), value.begin(), value.end());
+      if (c.values.size() > static_cast<size_t>(INT32_MAX))
+      {
+        throw std::length_error("String column exceeds Arrow int32 offsets");
+      }
+      c.offsets.push_back(static_cast<int32_t>(c.values.size()));
+    }
+    else if (type == field_type::boolean)
+    {
+      bool value;
+      in >> value;
+      arrow_detail::set_bit(c.values, m_rows, value);
+    }
+    else
+    {
+      visit_scalar(type, [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        T value;
+        in >> value;
+        const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+        c.values.insert(c.values.end(), bytes, bytes + sizeof(T));
+      });
+    }
+  }
+
+  static void import_column(const ArrowArray &source, size_t parent_offset,
+                            size_t rows, field_type type,
+                            arrow_detail::column &c)
+  {
+    const size_t start = parent_offset + static_cast<size_t>(source.offset);
+    if (type == field_type::string)
+    {
+      const auto *offsets = static_cast<const int32_t *>(source.buffers[1]);
+      const auto *chars = static_cast<const uint8_t *>(source.buffers[2]);
+      const int32_t base = offsets[start];
+      c.offsets.resize(rows + 1);
+      for (size_t r = 0; r <= rows; ++r)
+      {
+        c.offsets[r] = offsets[start + r] - base;
+      }
+      c.values.assign(chars + base, chars + offsets[start + rows]);
+    }
+    else if (type == field_type::boolean)
+    {
+      const auto *bits = static_cast<const uint8_t *>(source.buffers[1]);
+      c.values.assign((rows + 7) / 8, 0);
+      for (size_t r = 0; r < rows; ++r)
+      {
+        arrow_detail::set_bit(c.values, r, arrow_detail::get_bit(bits, start + r));
+      }
+    }
+    else
+    {
+      const size_t width = fixed_width(type);
+      const auto *data = static_cast<const uint8_t *>(source.buffers[1]);
+      c.values.assign(data + start * width, data + (start + rows) * width);
+    }
+  }
+};
+
+}
@@ -1,14 +1,34 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <bitset>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <complex>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <initializer_list>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <typeindex>
+#include <unordered_map>
 #include <vector>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BINARY_SERIALIZER_SSE2 1
+#endif
+
 namespace binary_serializer
 {
 
@@ -19,6 +39,32 @@ enum class endianness
   native
 };
 
+// Width of each quantized element; the value is its size in bytes.
+enum class quantization : uint8_t
+{
+  bits8 = 1,
+  bits16 = 2,
+  bits32 = 4
+};
+
+// Wire form of std::chrono durations and time points with integral counts:
+// the raw count, a zigzag varint, or (time points only) a zigzag varint of
+// the difference from the previous time point in the same stream.
+enum class time_encoding : uint8_t
+{
+  fixed,
+  varint,
+  delta
+};
+
+template <typename T> struct is_complex : std::false_type
+{
+};
+template <typename T> struct is_complex<std::complex<T>> : std::true_type
+{
+};
+template <typename T> constexpr bool is_complex_v = is_complex<T>::value;
+
 inline endianness get_system_endianness()
 {
   constexpr uint32_t test = 0x12345678;
@@ -71,12 +117,157 @@ template <typename T> inline T swap_endianness(T value)
   }
 }
 
+// Unaligned store/load of a single value, used where several fixed-width
+// fields are packed into one block before it is appended to a Buffer.
+template <typename T> inline void store_value(uint8_t *out, T value, bool swap)
+{
+  if (swap)
+    value = swap_endianness(value);
+  std::memcpy(out, &value, sizeof(T));
+}
+
+template <typename T> inline T load_value(const uint8_t *in, bool swap)
+{
+  T value;
+  std::memcpy(&value, in, sizeof(T));
+  return swap ? swap_endianness(value) : value;
+}
+
+constexpr uint64_t fnv1a_offset_basis = 0xcbf29ce484222325ULL;
+
+inline uint64_t fnv1a_64(const uint8_t *bytes, size_t count,
+                         uint64_t hash = fnv1a_offset_basis)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Collapses every NaN payload to the default quiet NaN and -0.0 to 0.0 so
+// equal values always produce identical bytes.
+template <typename T> inline T canonical_float(T value)
+{
+  static_assert(std::is_floating_point_v<T>, "Type must be floating point");
+
+  if (std::isnan(value))
+    return std::numeric_limits<T>::quiet_NaN();
+  if (value == T(0))
+    return T(0);
+  return value;
+}
+
+namespace utf8_detail
+{
+
+// Length of the leading run of ASCII bytes, sixteen bytes per step where
+// SSE2 is available and eight otherwise.
+inline size_t ascii_prefix(const uint8_t *bytes, size_t count)
+{
+  size_t i = 0;
+#ifdef BINARY_SERIALIZER_SSE2
+  for (; i + 16 <= count; i += 16)
+  {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i));
+    if (_mm_movemask_epi8(chunk) != 0)
+      break;
+  }
+#endif
+  for (; i + 8 <= count; i += 8)
+  {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    if (word & 0x8080808080808080ULL)
+      break;
+  }
+  while (i < count && bytes[i] < 0x80)
+    ++i;
+  return i;
+}
+
+inline bool in_range(uint8_t byte, uint8_t low, uint8_t high)
+{
+  return byte >= low && byte <= high;
+}
+
+// Length of the multi-byte sequence at `bytes`, or 0 when it is malformed,
+// overlong, a surrogate or beyond U+10FFFF.
+inline size_t sequence_length(const uint8_t *bytes, size_t count)
+{
+  const uint8_t lead = bytes[0];
+  if (in_range(lead, 0xC2, 0xDF))
+    return count >= 2 && in_range(bytes[1], 0x80, 0xBF) ? 2 : 0;
+  if (in_range(lead, 0xE0, 0xEF))
+  {
+    const uint8_t low = lead == 0xE0 ? 0xA0 : 0x80;
+    const uint8_t high = lead == 0xED ? 0x9F : 0xBF;
+    return count >= 3 && in_range(bytes[1], low, high) &&
+                   in_range(bytes[2], 0x80, 0xBF)
+               ? 3
+               : 0;
+  }
+  if (in_range(lead, 0xF0, 0xF4))
+  {
+    const uint8_t low = lead == 0xF0 ? 0x90 : 0x80;
+    const uint8_t high = lead == 0xF4 ? 0x8F : 0xBF;
+    return count >= 4 && in_range(bytes[1], low, high) &&
+                   in_range(bytes[2], 0x80, 0xBF) &&
+                   in_range(bytes[3], 0x80, 0xBF)
+               ? 4
+               : 0;
+  }
+  return 0;
+}
+
+} // namespace utf8_detail
+
+// ASCII runs are skipped a block at a time; only multi-byte sequences are
+// decoded individually.
+inline bool is_valid_utf8(const uint8_t *bytes, size_t count)
+{
+  size_t i = 0;
+  while (i < count)
+  {
+    i += utf8_detail::ascii_prefix(bytes + i, count - i);
+    if (i == count)
+      return true;
+    const size_t length = utf8_detail::sequence_length(bytes + i, count - i);
+    if (length == 0)
+      return false;
+    i += length;
+  }
+  return true;
+}
+
+// Non-owning reference to encoded bytes.
+struct byte_view
+{
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+
+  byte_view() = default;
+  byte_view(const uint8_t *bytes, size_t count) : data(bytes), size(count)
+  {}
+  byte_view(const std::vector<uint8_t> &bytes)
+      : data(bytes.data()), size(bytes.size())
+  {}
+};
+
 class Buffer
 {
 private:
   std::vector<uint8_t> m_data;
+  const uint8_t *m_view = nullptr;
+  size_t m_view_size = 0;
+  bool m_is_view = false;
   size_t m_position = 0;
   endianness m_endianness;
+  bool m_canonical = false;
+  bool m_validate_utf8 = false;
+  bool m_hashing = false;
+  uint64_t m_hash = fnv1a_offset_basis;
 
 public:
   explicit Buffer(endianness endian = endianness::native) : m_endianness(endian)
@@ -95,19 +286,58 @@ public:
     }
   }
 
+  // Read-only buffer over bytes owned by the caller, who must keep them
+  // alive while the buffer is in use.
+  explicit Buffer(byte_view view, endianness endian = endianness::native)
+      : m_view(view.data), m_view_size(view.size), m_is_view(true),
+        m_endianness(endian)
+  {
+    if (m_endianness == endianness::native)
+    {
+      m_endianness = get_system_endianness();
+    }
+  }
+
   void reserve(size_t size)
   {
     m_data.reserve(size);
   }
+  size_t capacity() const
+  {
+    return m_data.capacity();
+  }
   void clear()
   {
     m_data.clear();
+    m_view = nullptr;
+    m_view_size = 0;
+    m_is_view = false;
+    m_position = 0;
+    m_hash = fnv1a_offset_basis;
+  }
+
+  // Rebinds the buffer to new input, keeping its byte order and modes.
+  // Lvalue vectors bind as views; only rvalues are taken over.
+  void reset(byte_view view)
+  {
+    m_data.clear();
+    m_view = view.data;
+    m_view_size = view.size;
+    m_is_view = true;
+    m_position = 0;
+  }
+  void reset(std::vector<uint8_t> &&data)
+  {
+    m_data = std::move(data);
+    m_view = nullptr;
+    m_view_size = 0;
+    m_is_view = false;
     m_position = 0;
   }
 
   size_t size() const
   {
-    return m_data.size();
+    return m_is_view ? m_view_size : m_data.size();
   }
   size_t position() const
   {
@@ -120,7 +350,15 @@ public:
 
   const uint8_t *data() const
   {
-    return m_data.data();
+    return m_is_view ? m_view : m_data.data();
+  }
+  byte_view view() const
+  {
+    return byte_view(data(), size());
+  }
+  bool is_view() const
+  {
+    return m_is_view;
   }
   const std::vector<uint8_t> &vector() const
   {
@@ -136,21 +374,96 @@ public:
     m_endianness = endian;
   }
 
+  bool is_canonical() const
+  {
+    return m_canonical;
+  }
+  void set_canonical(bool canonical)
+  {
+    m_canonical = canonical;
+  }
+
+  // When set, decoded strings must be well-formed UTF-8.
+  bool validates_utf8() const
+  {
+    return m_validate_utf8;
+  }
+  void set_validate_utf8(bool validate)
+  {
+    m_validate_utf8 = validate;
+  }
+
+  // Hashes every byte as it is appended, so the digest of the encoded
+  // message is available without another pass over the data.
+  void enable_hash()
+  {
+    m_hashing = true;
+    m_hash = fnv1a_64(m_data.data(), m_data.size());
+  }
+  uint64_t hash() const
+  {
+    return m_hashing ? m_hash : fnv1a_64(data(), size());
+  }
+
   template <typename T> void write_raw(const T &value)
   {
-    const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
-    m_data.insert(m_data.end(), bytes, bytes + sizeof(T));
+    write_bytes(reinterpret_cast<const uint8_t *>(&value), sizeof(T));
+  }
+
+  void write_bytes(const uint8_t *bytes, size_t count)
+  {
+    m_data.insert(m_data.end(), bytes, bytes + count);
+    if (m_hashing)
+      m_hash = fnv1a_64(bytes, count, m_hash);
+  }
+
+  // Replaces `old_count` bytes at `offset` with `count` new bytes, shifting
+  // the tail when the sizes differ.
+  void replace_bytes(size_t offset, size_t old_count, const uint8_t *bytes,
+                     size_t count)
+  {
+    if (offset + old_count > m_data.size())
+    {
+      throw std::runtime_error("Replace range beyond buffer");
+    }
+
+    if (count == old_count)
+    {
+      std::memcpy(m_data.data() + offset, bytes, count);
+    }
+    else
+    {
+      auto first = m_data.begin() + static_cast<std::ptrdiff_t>(offset);
+      m_data.erase(first, first + static_cast<std::ptrdiff_t>(old_count));
+      m_data.insert(m_data.begin() + static_cast<std::ptrdiff_t>(offset),
+                    bytes, bytes + count);
+    }
+    if (m_hashing)
+      m_hash = fnv1a_64(m_data.data(), m_data.size());
+  }
+
+  // Returns the next `count` bytes in place and advances past them.
+  const uint8_t *read_bytes(size_t count)
+  {
+    if (count > size() - m_position)
+    {
+      throw std::runtime_error("Buffer underflow");
+    }
+
+    const uint8_t *bytes = data() + m_position;
+    m_position += count;
+    return bytes;
   }
 
   template <typename T> T read_raw()
   {
-    if (m_position + sizeof(T) > m_data.size())
+    if (m_position + sizeof(T) > size())
     {
       throw std::runtime_error("Buffer underflow");
     }
 
     T value;
-    std::memcpy(&value, m_data.data() + m_position, sizeof(T));
+    std::memcpy(&value, data() + m_position, sizeof(T));
     m_position += sizeof(T);
     return value;
   }
@@ -159,6 +472,11 @@ public:
   {
     static_assert(std::is_arithmetic_v<T>, "Type must be arithmetic");
 
+    if constexpr (std::is_floating_point_v<T>)
+    {
+      if (m_canonical)
+        value = canonical_float(value);
+    }
     if (m_endianness != get_system_endianness())
     {
       value = swap_endianness(value);
@@ -178,154 +496,1572 @@ public:
     return value;
   }
 
-  void write_string(const std::string &str)
+  void write_string(std::string_view str)
   {
     write<uint32_t>(static_cast<uint32_t>(str.length()));
-    m_data.insert(m_data.end(), str.begin(), str.end());
+    write_bytes(reinterpret_cast<const uint8_t *>(str.data()), str.length());
   }
 
   std::string read_string()
+  {
+    return std::string(read_string_view());
+  }
+
+  // Zero-copy variant; the view points into the buffer's bytes.
+  std::string_view read_string_view()
   {
     auto length = read<uint32_t>();
-    if (m_position + length > m_data.size())
+    if (m_position + length > size())
     {
       throw std::runtime_error("String extends beyond buffer");
     }
 
-    std::string result(m_data.begin() + m_position,
-                       m_data.begin() + m_position + length);
+    const uint8_t *bytes = data() + m_position;
+    if (m_validate_utf8 && !is_valid_utf8(bytes, length))
+    {
+      throw std::runtime_error("String is not valid UTF-8");
+    }
+
     m_position += length;
-    return result;
+    return std::string_view(reinterpret_cast<const char *>(bytes), length);
   }
 
-  template <typename T> void write_array(const T *array, size_t count)
+  // LEB128, seven bits per byte, least significant group first.
+  void write_varint(uint64_t value)
   {
-    write<uint32_t>(static_cast<uint32_t>(count));
-    for (size_t i = 0; i < count; ++i)
+    uint8_t bytes[10];
+    size_t count = 0;
+    while (value >= 0x80)
+    {
+      bytes[count++] = static_cast<uint8_t>(value | 0x80);
+      value >>= 7;
+    }
+    bytes[count++] = static_cast<uint8_t>(value);
+    write_bytes(bytes, count);
+  }
+
+  uint64_t read_varint()
+  {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
     {
-      write(array[i]);
+      if (m_position >= size())
+      {
+        throw std::runtime_error("Buffer underflow");
+      }
+      const uint8_t byte = data()[m_position++];
+      if (shift == 63 && byte > 1)
+      {
+        throw std::runtime_error("Varint overflow");
+      }
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0)
+      {
+        if (m_canonical && byte == 0 && shift != 0)
+        {
+          throw std::runtime_error("Non-minimal varint");
+        }
+        return value;
+      }
     }
+    throw std::runtime_error("Varint overflow");
+  }
+
+  void write_svarint(int64_t value)
+  {
+    write_varint((static_cast<uint64_t>(value) << 1) ^
+                 static_cast<uint64_t>(value >> 63));
+  }
+
+  int64_t read_svarint()
+  {
+    const uint64_t value = read_varint();
+    return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+  }
+
+  template <typename T> void write_array(const T *array, size_t count)
+  {
+    write<uint32_t>(static_cast<uint32_t>(count));
+    write_bulk(array, count);
   }
 
   template <typename T> std::vector<T> read_array()
   {
     auto count = read<uint32_t>();
-    std::vector<T> result;
-    result.reserve(count);
-
-    for (uint32_t i = 0; i < count; ++i)
+    if (count > (size() - m_position) / sizeof(T))
     {
-      result.push_back(read<T>());
+      throw std::runtime_error("Array extends beyond buffer");
     }
+
+    std::vector<T> result(count);
+    read_bulk(result.data(), count);
     return result;
   }
-};
-
-class Serializer
-{
-private:
-  Buffer m_buffer;
-
-public:
-  explicit Serializer(endianness endian = endianness::native) : m_buffer(endian){}
 
-  // Primitive types
-  template <typename T> Serializer &operator<<(T value)
+  // Writes `count` values without a length prefix: one memcpy when the byte
+  // order matches the host, otherwise a single swap pass into the buffer.
+  template <typename T> void write_bulk(const T *array, size_t count)
   {
     static_assert(std::is_arithmetic_v<T>, "Type must be arithmetic");
-    m_buffer.write(value);
-    return *this;
+
+    const bool normalize = std::is_floating_point_v<T> && m_canonical;
+    if (m_endianness == get_system_endianness() && !normalize)
+    {
+      write_bytes(reinterpret_cast<const uint8_t *>(array), count * sizeof(T));
+      return;
+    }
+
+    const size_t start = m_data.size();
+    m_data.resize(start + count * sizeof(T));
+    uint8_t *out = m_data.data() + start;
+    const bool swap = m_endianness != get_system_endianness();
+    for (size_t i = 0; i < count; ++i)
+    {
+      T value = array[i];
+      if constexpr (std::is_floating_point_v<T>)
+      {
+        if (normalize)
+          value = canonical_float(value);
+      }
+      if (swap)
+        value = swap_endianness(value);
+      std::memcpy(out + i * sizeof(T), &value, sizeof(T));
+    }
+    if (m_hashing)
+      m_hash = fnv1a_64(out, count * sizeof(T), m_hash);
   }
 
-  Serializer &operator<<(const std::string &str)
+  template <typename T> void read_bulk(T *out, size_t count)
   {
-    m_buffer.write_string(str);
-    return *this;
+    static_assert(std::is_arithmetic_v<T>, "Type must be arithmetic");
+
+    if (count > (size() - m_position) / sizeof(T))
+    {
+      throw std::runtime_error("Buffer underflow");
+    }
+
+    if (count == 0)
+      return;
+    std::memcpy(out, data() + m_position, count * sizeof(T));
+    m_position += count * sizeof(T);
+    if (m_endianness != get_system_endianness())
+    {
+      for (size_t i = 0; i < count; ++i)
+      {
+        out[i] = swap_endianness(out[i]);
+      }
+    }
   }
 
-  Serializer &operator<<(const char *str)
+  // Lossy encoding: values are mapped onto [0, 2^bits - 1] between the array
+  // minimum and maximum, which are stored as offset/scale ahead of the data.
+  template <typename T>
+  void write_quantized_array(const T *array, size_t count, quantization q)
   {
-    m_buffer.write_string(std::string(str));
-    return *this;
+    static_assert(std::is_floating_point_v<T>, "Type must be floating point");
+
+    double lo = 0.0;
+    double hi = 0.0;
+    for (size_t i = 0; i < count; ++i)
+    {
+      const double v = static_cast<double>(array[i]);
+      if (!std::isfinite(v))
+      {
+        throw std::runtime_error("Cannot quantize non-finite value");
+      }
+      if (i == 0 || v < lo)
+        lo = v;
+      if (i == 0 || v > hi)
+        hi = v;
+    }
+
+    const double levels = quantization_levels(q);
+    const double scale = hi > lo ? (hi - lo) / levels : 1.0;
+
+    write<uint32_t>(static_cast<uint32_t>(count));
+    write<uint8_t>(static_cast<uint8_t>(q));
+    write<double>(lo);
+    write<double>(scale);
+
+    switch (q)
+    {
+    case quantization::bits8:
+      write_quantized_values<uint8_t>(array, count, lo, 1.0 / scale, levels);
+      break;
+    case quantization::bits16:
+      write_quantized_values<uint16_t>(array, count, lo, 1.0 / scale, levels);
+      break;
+    case quantization::bits32:
+      write_quantized_values<uint32_t>(array, count, lo, 1.0 / scale, levels);
+      break;
+    default:
+      throw std::runtime_error("Invalid quantization width");
+    }
   }
 
-  template <typename T, size_t N>
-  Serializer &operator<<(const std::array<T, N> &arr)
+  template <typename T> std::vector<T> read_quantized_array()
   {
-    m_buffer.write_array(arr.data(), N);
-    return *this;
+    static_assert(std::is_floating_point_v<T>, "Type must be floating point");
+
+    auto count = read<uint32_t>();
+    const auto q = static_cast<quantization>(read<uint8_t>());
+    const size_t width = quantized_width(q);
+    auto offset = read<double>();
+    auto scale = read<double>();
+    if (count > (size() - m_position) / width)
+    {
+      throw std::runtime_error("Quantized array extends beyond buffer");
+    }
+
+    std::vector<T> result(count);
+    switch (q)
+    {
+    case quantization::bits8:
+      read_quantized_values<uint8_t>(result.data(), count, offset, scale);
+      break;
+    case quantization::bits16:
+      read_quantized_values<uint16_t>(result.data(), count, offset, scale);
+      break;
+    case quantization::bits32:
+      read_quantized_values<uint32_t>(result.data(), count, offset, scale);
+      break;
+    default:
+      throw std::runtime_error("Invalid quantization width");
+    }
+    return result;
   }
 
-  template <typename T> Serializer &operator<<(const std::vector<T> &vec)
+private:
+  static size_t quantized_width(quantization q)
   {
-    m_buffer.write_array(vec.data(), vec.size());
-    return *this;
+    if (q != quantization::bits8 && q != quantization::bits16 &&
+        q != quantization::bits32)
+    {
+      throw std::runtime_error("Invalid quantization width");
+    }
+    return static_cast<size_t>(q);
   }
 
-  const Buffer &get_buffer() const
+  static double quantization_levels(quantization q)
   {
-    return m_buffer;
+    return static_cast<double>((uint64_t(1) << (8 * quantized_width(q))) - 1);
   }
-  std::vector<uint8_t> get_data() const
+
+  template <typename Q, typename T>
+  void write_quantized_values(const T *array, size_t count, double offset,
+                              double inv_scale, double levels)
   {
-    return m_buffer.vector();
+    const bool swap = m_endianness != get_system_endianness();
+    const size_t start = m_data.size();
+    m_data.resize(start + count * sizeof(Q));
+    uint8_t *out = m_data.data() + start;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      double scaled = (static_cast<double>(array[i]) - offset) * inv_scale;
+      scaled = std::min(std::max(scaled + 0.5, 0.0), levels);
+      Q q = static_cast<Q>(scaled);
+      if (swap)
+        q = swap_endianness(q);
+      std::memcpy(out + i * sizeof(Q), &q, sizeof(Q));
+    }
+    if (m_hashing)
+      m_hash = fnv1a_64(out, count * sizeof(Q), m_hash);
   }
-  void clear()
+
+  // Kept as separate straight-line loops so the compiler can vectorize the
+  // widen-multiply-add for the common native-endian case.
+  template <typename Q, typename T>
+  void read_quantized_values(T *out, size_t count, double offset, double scale)
   {
-    m_buffer.clear();
+    if (m_position + count * sizeof(Q) > size())
+    {
+      throw std::runtime_error("Quantized array extends beyond buffer");
+    }
+
+    const uint8_t *in = data() + m_position;
+    if (m_endianness == get_system_endianness())
+    {
+      for (size_t i = 0; i < count; ++i)
+      {
+        Q q;
+        std::memcpy(&q, in + i * sizeof(Q), sizeof(Q));
+        out[i] = static_cast<T>(offset + static_cast<double>(q) * scale);
+      }
+    }
+    else
+    {
+      for (size_t i = 0; i < count; ++i)
+      {
+        Q q;
+        std::memcpy(&q, in + i * sizeof(Q), sizeof(Q));
+        out[i] = static_cast<T>(offset +
+                                static_cast<double>(swap_endianness(q)) * scale);
+      }
+    }
+    m_position += count * sizeof(Q);
   }
 };
 
-class Deserializer
+// String with inline storage for at most N bytes. Encodes exactly like
+// std::string, so either side of a message can use it for bounded fields.
+template <size_t N> class fixed_string
 {
 private:
-  Buffer m_buffer;
+  std::array<char, N> m_data{};
+  size_t m_size = 0;
 
 public:
-  explicit Deserializer(std::vector<uint8_t> data,
-                        endianness endian = endianness::native)
-      : m_buffer(std::move(data), endian)
-  {}
-
-  // Primitive types
-  template <typename T> Deserializer &operator>>(T &value)
+  fixed_string() = default;
+  fixed_string(std::string_view str)
   {
-    static_assert(std::is_arithmetic_v<T>, "Type must be arithmetic");
-    value = m_buffer.read<T>();
-    return *this;
-  }
-
-  Deserializer &operator>>(std::string &str)
-  {
-    str = m_buffer.read_string();
-    return *this;
+    assign(str);
   }
 
-  template <typename T, size_t N>
-  Deserializer &operator>>(std::array<T, N> &arr)
+  void assign(std::string_view str)
   {
-    auto vec = m_buffer.read_array<T>();
-    if (vec.size() != N)
+    if (str.size() > N)
     {
-      throw std::runtime_error("Array size mismatch");
+      throw std::runtime_error("String exceeds fixed capacity");
     }
-    std::copy(vec.begin(), vec.end(), arr.begin());
-    return *this;
+    std::memcpy(m_data.data(), str.data(), str.size());
+    m_size = str.size();
   }
 
-  template <typename T> Deserializer &operator>>(std::vector<T> &vec)
+  static constexpr size_t capacity()
   {
-    vec = m_buffer.read_array<T>();
-    return *this;
+    return N;
   }
-
-  bool has_more() const
+  size_t size() const
   {
-    return m_buffer.position() < m_buffer.size();
+    return m_size;
   }
-  size_t remaining() const
+  bool empty() const
   {
-    return m_buffer.size() - m_buffer.position();
+    return m_size == 0;
+  }
+  const char *data() const
+  {
+    return m_data.data();
+  }
+  std::string_view view() const
+  {
+    return std::string_view(m_data.data(), m_size);
+  }
+  operator std::string_view() const
+  {
+    return view();
+  }
+
+  bool operator==(const fixed_string &other) const
+  {
+    return view() == other.view();
+  }
+  bool operator!=(const fixed_string &other) const
+  {
+    return !(*this == other);
+  }
+};
+
+// Vector with inline storage for at most N elements. Encodes exactly like
+// std::vector<T>.
+template <typename T, size_t N> class static_vector
+{
+private:
+  std::array<T, N> m_data{};
+  size_t m_size = 0;
+
+public:
+  static_vector() = default;
+  static_vector(std::initializer_list<T> values)
+  {
+    resize(values.size());
+    std::copy(values.begin(), values.end(), m_data.begin());
+  }
+
+  void resize(size_t size)
+  {
+    if (size > N)
+    {
+      throw std::runtime_error("Vector exceeds fixed capacity");
+    }
+    m_size = size;
+  }
+  void push_back(const T &value)
+  {
+    resize(m_size + 1);
+    m_data[m_size - 1] = value;
+  }
+  void clear()
+  {
+    m_size = 0;
+  }
+
+  static constexpr size_t capacity()
+  {
+    return N;
+  }
+  size_t size() const
+  {
+    return m_size;
+  }
+  bool empty() const
+  {
+    return m_size == 0;
+  }
+  T *data()
+  {
+    return m_data.data();
+  }
+  const T *data() const
+  {
+    return m_data.data();
+  }
+  T &operator[](size_t index)
+  {
+    return m_data[index];
+  }
+  const T &operator[](size_t index) const
+  {
+    return m_data[index];
+  }
+  T *begin()
+  {
+    return m_data.data();
+  }
+  T *end()
+  {
+    return m_data.data() + m_size;
+  }
+  const T *begin() const
+  {
+    return m_data.data();
+  }
+  const T *end() const
+  {
+    return m_data.data() + m_size;
+  }
+
+  bool operator==(const static_vector &other) const
+  {
+    return std::equal(begin(), end(), other.begin(), other.end());
+  }
+  bool operator!=(const static_vector &other) const
+  {
+    return !(*this == other);
+  }
+};
+
+class Serializer;
+class Deserializer;
+
+// Opt-in marker for user types whose in-memory representation is their
+// wire form: trivially copyable, no padding or pointers. Such values, and
+// vectors and arrays of them, are copied in bulk at native byte order.
+// A specialization that also names `using element_type = float;` (or
+// another arithmetic type) declares the type to be a packed array of that
+// type, which lets foreign byte orders be handled by a bulk swap; without
+// it a foreign byte order falls back to the type's serialize functions or
+// throws.
+template <typename T> struct is_trivially_serializable : std::false_type
+{
+};
+template <typename T>
+constexpr bool is_trivially_serializable_v = is_trivially_serializable<T>::value;
+
+namespace extension_detail
+{
+
+template <typename T, typename = void>
+struct has_element_type : std::false_type
+{
+};
+template <typename T>
+struct has_element_type<
+    T, std::void_t<typename is_trivially_serializable<T>::element_type>>
+    : std::true_type
+{
+};
+
+// User types are encoded either by members
+//   void serialize(Serializer &) const;  void deserialize(Deserializer &);
+// or by free functions found through argument-dependent lookup
+//   void serialize(Serializer &, const T &);  void deserialize(Deserializer &, T &);
+template <typename T, typename = void>
+struct has_member_serialize : std::false_type
+{
+};
+template <typename T>
+struct has_member_serialize<T, std::void_t<decltype(std::declval<const T &>().serialize(
+                                   std::declval<Serializer &>()))>>
+    : std::true_type
+{
+};
+
+template <typename T, typename = void>
+struct has_member_deserialize : std::false_type
+{
+};
+template <typename T>
+struct has_member_deserialize<T, std::void_t<decltype(std::declval<T &>().deserialize(
+                                     std::declval<Deserializer &>()))>>
+    : std::true_type
+{
+};
+
+template <typename T, typename = void>
+struct has_adl_serialize : std::false_type
+{
+};
+template <typename T>
+struct has_adl_serialize<T, std::void_t<decltype(serialize(
+                                std::declval<Serializer &>(),
+                                std::declval<const T &>()))>> : std::true_type
+{
+};
+
+template <typename T, typename = void>
+struct has_adl_deserialize : std::false_type
+{
+};
+template <typename T>
+struct has_adl_deserialize<T, std::void_t<decltype(deserialize(
+                                  std::declval<Deserializer &>(),
+                                  std::declval<T &>()))>> : std::true_type
+{
+};
+
+template <typename T> constexpr bool dependent_false = false;
+
+} // namespace extension_detail
+
+class Serializer
+{
+private:
+  Buffer m_buffer;
+  // Written objects are kept alive so a freed address cannot be reused by
+  // a new object and mistaken for a back-reference.
+  struct shared_entry
+  {
+    uint32_t id;
+    std::shared_ptr<const void> owner;
+  };
+  std::unordered_map<const void *, shared_entry> m_shared_ids;
+  time_encoding m_time_encoding = time_encoding::fixed;
+  int64_t m_last_time = 0;
+  bool m_wrote_delta_time = false;
+
+public:
+  explicit Serializer(endianness endian = endianness::native) : m_buffer(endian){}
+
+  // Primitive types, trivially serializable types and user types with
+  // serialize functions
+  template <typename T> Serializer &operator<<(const T &value)
+  {
+    if constexpr (std::is_arithmetic_v<T>)
+    {
+      m_buffer.write(value);
+    }
+    else if constexpr (is_trivially_serializable_v<T>)
+    {
+      write_trivial(&value, 1);
+    }
+    else
+    {
+      write_custom(value);
+    }
+    return *this;
+  }
+
+  Serializer &operator<<(const std::string &str)
+  {
+    m_buffer.write_string(str);
+    return *this;
+  }
+
+  Serializer &operator<<(const std::pmr::string &str)
+  {
+    m_buffer.write_string(str);
+    return *this;
+  }
+
+  Serializer &operator<<(const char *str)
+  {
+    m_buffer.write_string(str);
+    return *this;
+  }
+
+  template <size_t N> Serializer &operator<<(const fixed_string<N> &str)
+  {
+    m_buffer.write_string(str.view());
+    return *this;
+  }
+
+  template <typename T, size_t N>
+  Serializer &operator<<(const static_vector<T, N> &vec)
+  {
+    if constexpr (std::is_arithmetic_v<T>)
+    {
+      m_buffer.write_array(vec.data(), vec.size());
+    }
+    else
+    {
+      m_buffer.write<uint32_t>(static_cast<uint32_t>(vec.size()));
+      for (const auto &element : vec)
+      {
+        *this << element;
+      }
+    }
+    return *this;
+  }
+
+  template <typename T, size_t N>
+  Serializer &operator<<(const std::array<T, N> &arr)
+  {
+    if constexpr (std::is_arithmetic_v<T>)
+    {
+      m_buffer.write_array(arr.data(), N);
+    }
+    else if constexpr (is_trivially_serializable_v<T>)
+    {
+      m_buffer.write<uint32_t>(static_cast<uint32_t>(N));
+      write_trivial(arr.data(), N);
+    }
+    else
+    {
+      write_elements(arr);
+    }
+    return *this;
+  }
+
+  template <typename T, typename A>
+  Serializer &operator<<(const std::vector<T, A> &vec)
+  {
+    if constexpr (std::is_arithmetic_v<T>)
+    {
+      m_buffer.write_array(vec.data(), vec.size());
+    }
+    else if constexpr (is_complex_v<T>)
+    {
+      // std::complex<V> is laid out as V[2], so the pairs go through the
+      // bulk path as one flat array.
+      using V = typename T::value_type;
+      m_buffer.write<uint32_t>(static_cast<uint32_t>(vec.size()));
+      m_buffer.write_bulk(reinterpret_cast<const V *>(vec.data()),
+                          vec.size() * 2);
+    }
+    else if constexpr (is_trivially_serializable_v<T>)
+    {
+      m_buffer.write<uint32_t>(static_cast<uint32_t>(vec.size()));
+      write_trivial(vec.data(), vec.size());
+    }
+    else
+    {
+      m_buffer.write<uint32_t>(static_cast<uint32_t>(vec.size()));
+      for (const auto &element : vec)
+      {
+        *this << element;
+      }
+    }
+    return *this;
+  }
+
+  template <typename V> Serializer &operator<<(const std::complex<V> &value)
+  {
+    m_buffer.write(value.real());
+    m_buffer.write(value.imag());
+    return *this;
+  }
+
+  // Bit i of the set is bit i % 64 of word i / 64; ceil(N / 64) words.
+  template <size_t N> Serializer &operator<<(const std::bitset<N> &bits)
+  {
+    std::array<uint64_t, (N + 63) / 64> words{};
+    for (size_t i = 0; i < N; ++i)
+    {
+      if (bits[i])
+        words[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    m_buffer.write_bulk(words.data(), words.size());
+    return *this;
+  }
+
+  template <typename Rep, typename Period>
+  Serializer &operator<<(const std::chrono::duration<Rep, Period> &duration)
+  {
+    if constexpr (std::is_integral_v<Rep>)
+    {
+      if (m_time_encoding != time_encoding::fixed)
+      {
+        m_buffer.write_svarint(static_cast<int64_t>(duration.count()));
+        return *this;
+      }
+    }
+    m_buffer.write(duration.count());
+    return *this;
+  }
+
+  template <typename Clock, typename Duration>
+  Serializer &operator<<(const std::chrono::time_point<Clock, Duration> &time)
+  {
+    if constexpr (std::is_integral_v<typename Duration::rep>)
+    {
+      if (m_time_encoding == time_encoding::delta)
+      {
+        const auto count = static_cast<int64_t>(time.time_since_epoch().count());
+        m_buffer.write_svarint(static_cast<int64_t>(
+            static_cast<uint64_t>(count) - static_cast<uint64_t>(m_last_time)));
+        m_last_time = count;
+        m_wrote_delta_time = true;
+        return *this;
+      }
+    }
+    return *this << time.time_since_epoch();
+  }
+
+  template <typename T, typename A>
+  Serializer &operator<<(const std::deque<T, A> &deq)
+  {
+    if constexpr (std::is_arithmetic_v<T>)
+    {
+      // A deque stores its elements in fixed-size blocks; each block's run
+      // is written with one bulk copy.
+      m_buffer.write<uint32_t>(static_cast<uint32_t>(deq.size()));
+      for (size_t i = 0; i < deq.size();)
+      {
+        const T *run = &deq[i];
+        size_t length = 1;
+        while (i + length < deq.size() && &deq[i + length] == run + length)
+        {
+          ++length;
+        }
+        m_buffer.write_bulk(run, length);
+        i += length;
+      }
+    }
+    else
+    {
+      write_elements(deq);
+    }
+    return *this;
+  }
+
+  template <typename T, typename A>
+  Serializer &operator<<(const std::list<T, A> &list)
+  {
+    write_elements(list);
+    return *this;
+  }
+
+  template <typename K, typename V>
+  Serializer &operator<<(const std::map<K, V> &map)
+  {
+    m_buffer.write<uint32_t>(static_cast<uint32_t>(map.size()));
+    for (const auto &entry : map)
+    {
+      *this << entry.first << entry.second;
+    }
+    return *this;
+  }
+
+  template <typename K, typename V>
+  Serializer &operator<<(const std::unordered_map<K, V> &map)
+  {
+    m_buffer.write<uint32_t>(static_cast<uint32_t>(map.size()));
+    if (!m_buffer.is_canonical())
+    {
+      for (const auto &entry : map)
+      {
+        *this << entry.first << entry.second;
+      }
+      return *this;
+    }
+
+    std::vector<const std::pair<const K, V> *> entries;
+    entries.reserve(map.size());
+    for (const auto &entry : map)
+    {
+      entries.push_back(&entry);
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const auto *a, const auto *b) { return a->first < b->first; });
+    for (const auto *entry : entries)
+    {
+      *this << entry->first << entry->second;
+    }
+    return *this;
+  }
+
+  // Each shared object is written once; later references to the same
+  // object are written as its varint ID (0 is null).
+  template <typename T> Serializer &operator<<(const std::shared_ptr<T> &ptr)
+  {
+    if (!ptr)
+    {
+      m_buffer.write_varint(0);
+      return *this;
+    }
+
+    const auto next_id = static_cast<uint32_t>(m_shared_ids.size() + 1);
+    auto result = m_shared_ids.emplace(ptr.get(), shared_entry{next_id, ptr});
+    m_buffer.write_varint(result.first->second.id);
+    if (result.second)
+    {
+      *this << *ptr;
+    }
+    return *this;
+  }
+
+  template <typename T> Serializer &operator<<(const std::unique_ptr<T> &ptr)
+  {
+    m_buffer.write<uint8_t>(ptr ? 1 : 0);
+    if (ptr)
+    {
+      *this << *ptr;
+    }
+    return *this;
+  }
+
+  template <typename T>
+  Serializer &write_quantized(const std::vector<T> &vec, quantization q)
+  {
+    m_buffer.write_quantized_array(vec.data(), vec.size(), q);
+    return *this;
+  }
+
+  // Appends already encoded bytes verbatim, e.g. a previously serialized
+  // sub-message.
+  Serializer &write_bytes(const uint8_t *bytes, size_t count)
+  {
+    m_buffer.write_bytes(bytes, count);
+    return *this;
+  }
+
+  Serializer &write_varint(uint64_t value)
+  {
+    m_buffer.write_varint(value);
+    return *this;
+  }
+
+  Serializer &write_svarint(int64_t value)
+  {
+    m_buffer.write_svarint(value);
+    return *this;
+  }
+
+  // Canonical mode normalizes floats and sorts unordered map keys so equal
+  // values always serialize to the same bytes.
+  void set_canonical(bool canonical)
+  {
+    m_buffer.set_canonical(canonical);
+  }
+
+  // Both ends of a stream must use the same time encoding.
+  void set_time_encoding(time_encoding encoding)
+  {
+    m_time_encoding = encoding;
+  }
+  time_encoding get_time_encoding() const
+  {
+    return m_time_encoding;
+  }
+
+  // True once output depends on what was written before it: shared objects
+  // numbered by this serializer or delta-encoded time points. Such bytes
+  // cannot be spliced into another stream.
+  bool has_stream_state() const
+  {
+    return !m_shared_ids.empty() || m_wrote_delta_time;
+  }
+  void enable_hash()
+  {
+    m_buffer.enable_hash();
+  }
+  uint64_t hash() const
+  {
+    return m_buffer.hash();
+  }
+
+  const Buffer &get_buffer() const
+  {
+    return m_buffer;
+  }
+  std::vector<uint8_t> get_data() const
+  {
+    return m_buffer.vector();
+  }
+  void clear()
+  {
+    m_buffer.clear();
+    m_shared_ids.clear();
+    m_last_time = 0;
+    m_wrote_delta_time = false;
+  }
+
+private:
+  template <typename T> void write_custom(const T &value)
+  {
+    if constexpr (extension_detail::has_member_serialize<T>::value)
+    {
+      value.serialize(*this);
+    }
+    else if constexpr (extension_detail::has_adl_serialize<T>::value)
+    {
+      serialize(*this, value);
+    }
+    else
+    {
+      static_assert(extension_detail::dependent_false<T>,
+                    "Type is not serializable: provide serialize() or "
+                    "specialize is_trivially_serializable");
+    }
+  }
+
+  template <typename T> void write_trivial(const T *values, size_t count)
+  {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Trivially serializable types must be trivially copyable");
+
+    if (m_buffer.get_endianness() == get_system_endianness())
+    {
+      m_buffer.write_bytes(reinterpret_cast<const uint8_t *>(values),
+                           count * sizeof(T));
+    }
+    else if constexpr (extension_detail::has_element_type<T>::value)
+    {
+      using E = typename is_trivially_serializable<T>::element_type;
+      static_assert(sizeof(T) % sizeof(E) == 0, "Element type must tile T");
+      m_buffer.write_bulk(reinterpret_cast<const E *>(values),
+                          count * (sizeof(T) / sizeof(E)));
+    }
+    else if constexpr (extension_detail::has_member_serialize<T>::value ||
+                       extension_detail::has_adl_serialize<T>::value)
+    {
+      for (size_t i = 0; i < count; ++i)
+      {
+        write_custom(values[i]);
+      }
+    }
+    else
+    {
+      throw std::runtime_error(
+          "Trivially serializable type requires native byte order");
+    }
+  }
+
+  template <typename Sequence> void write_elements(const Sequence &sequence)
+  {
+    m_buffer.write<uint32_t>(static_cast<uint32_t>(sequence.size()));
+    for (const auto &element : sequence)
+    {
+      *this << element;
+    }
+  }
+};
+
+class Deserializer
+{
+private:
+  Buffer m_buffer;
+  // Decoded objects with the type they were decoded as; a back-reference
+  // must name the same type.
+  struct shared_object
+  {
+    std::shared_ptr<void> object;
+    std::type_index type;
+  };
+  std::vector<shared_object> m_shared_objects;
+  time_encoding m_time_encoding = time_encoding::fixed;
+  int64_t m_last_time = 0;
+  std::shared_ptr<std::pmr::monotonic_buffer_resource> m_arena;
+
+public:
+  explicit Deserializer(std::vector<uint8_t> data,
+                        endianness endian = endianness::native)
+      : m_buffer(std::move(data), endian)
+  {}
+
+  // Decodes in place from caller-owned bytes without copying them.
+  explicit Deserializer(byte_view data, endianness endian = endianness::native)
+      : m_buffer(data, endian)
+  {}
+
+  // Starts decoding a new message with the same byte order, modes and
+  // arena, so one long-lived decoder can serve a whole stream. Objects
+  // decoded into the arena stay valid until release_arena(). An lvalue
+  // vector is read in place; pass an rvalue to hand over ownership.
+  void reset(byte_view data)
+  {
+    m_buffer.reset(data);
+    m_shared_objects.clear();
+    m_last_time = 0;
+  }
+  void reset(std::vector<uint8_t> &&data)
+  {
+    m_buffer.reset(std::move(data));
+    m_shared_objects.clear();
+    m_last_time = 0;
+  }
+
+  // Primitive types, trivially serializable types and user types with
+  // deserialize functions
+  template <typename T> Deserializer &operator>>(T &value)
+  {
+    if constexpr (std::is_arithmetic_v<T>)
+    {
+      value = m_buffer.read<T>();
+    }
+    else if constexpr (is_trivially_serializable_v<T>)
+    {
+      read_trivial(&value, 1);
+    }
+    else
+    {
+      read_custom(value);
+    }
+    return *this;
+  }
+
+  Deserializer &operator>>(std::string &str)
+  {
+    str = m_buffer.read_string();
+    return *this;
+  }
+
+  Deserializer &operator>>(std::string_view &str)
+  {
+    str = m_buffer.read_string_view();
+    return *this;
+  }
+
+  // Copies into the string's own allocator, so strings created by make()
+  // are filled from the arena.
+  Deserializer &operator>>(std::pmr::string &str)
+  {
+    auto view = m_buffer.read_string_view();
+    str.assign(view.data(), view.size());
+    return *this;
+  }
+
+  template <typename T, size_t N>
+  Deserializer &operator>>(std::array<T, N> &arr)
+  {
+    if (m_buffer.read<uint32_t>() != N)
+    {
+      throw std::runtime_error("Array size mismatch");
+    }
+    if constexpr (std::is_arithmetic_v<T>)
+    {
+      m_buffer.read_bulk(arr.data(), N);
+    }
+    else if constexpr (is_trivially_serializable_v<T>)
+    {
+      read_trivial(arr.data(), N);
+    }
+    else
+    {
+      for (auto &element : arr)
+      {
+        *this >> element;
+      }
+    }
+    return *this;
+  }
+
+  template <size_t N> Deserializer &operator>>(fixed_string<N> &str)
+  {
+    auto view = m_buffer.read_string_view();
+    if (view.size() > N)
+    {
+      throw std::runtime_error("String exceeds fixed capacity");
+    }
+    str.assign(view);
+    return *this;
+  }
+
+  template <typename T, size_t N>
+  Deserializer &operator>>(static_vector<T, N> &vec)
+  {
+    auto count = m_buffer.read<uint32_t>();
+    if (count > N)
+    {
+      throw std::runtime_error("Vector exceeds fixed capacity");
+    }
+    vec.resize(count);
+    if constexpr (std::is_arithmetic_v<T>)
+    {
+      m_buffer.read_bulk(vec.data(), count);
+    }
+    else
+    {
+      for (auto &element : vec)
+      {
+        *this >> element;
+      }
+    }
+    return *this;
+  }
+
+  template <typename T, typename A>
+  Deserializer &operator>>(std::vector<T, A> &vec)
+  {
+    if constexpr (std::is_arithmetic_v<T>)
+    {
+      auto count = m_buffer.read<uint32_t>();
+      if (count > remaining() / sizeof(T))
+      {
+        throw std::runtime_error("Array extends beyond buffer");
+      }
+      vec.resize(count);
+      m_buffer.read_bulk(vec.data(), count);
+    }
+    else if constexpr (is_complex_v<T>)
+    {
+      using V = typename T::value_type;
+      auto count = m_buffer.read<uint32_t>();
+      if (count > remaining() / sizeof(T))
+      {
+        throw std::runtime_error("Array extends beyond buffer");
+      }
+      vec.resize(count);
+      m_buffer.read_bulk(reinterpret_cast<V *>(vec.data()), count * 2);
+    }
+    else if constexpr (is_trivially_serializable_v<T>)
+    {
+      auto count = m_buffer.read<uint32_t>();
+      if (count > remaining() / sizeof(T))
+      {
+        throw std::runtime_error("Array extends beyond buffer");
+      }
+      vec.resize(count);
+      read_trivial(vec.data(), count);
+    }
+    else
+    {
+      auto count = m_buffer.read<uint32_t>();
+      if (count > remaining())
+      {
+        throw std::runtime_error("Vector extends beyond buffer");
+      }
+      vec.clear();
+      vec.resize(count);
+      for (auto &element : vec)
+      {
+        *this >> element;
+      }
+    }
+    return *this;
+  }
+
+  template <typename V> Deserializer &operator>>(std::complex<V> &value)
+  {
+    const V real = m_buffer.read<V>();
+    value = std::complex<V>(real, m_buffer.read<V>());
+    return *this;
+  }
+
+  template <size_t N> Deserializer &operator>>(std::bitset<N> &bits)
+  {
+    std::array<uint64_t, (N + 63) / 64> words{};
+    m_buffer.read_bulk(words.data(), words.size());
+    if constexpr (N % 64 != 0)
+    {
+      if (m_buffer.is_canonical() && (words.back() >> (N % 64)) != 0)
+      {
+        throw std::runtime_error("Bitset padding bits set");
+      }
+    }
+    bits.reset();
+    for (size_t i = 0; i < N; ++i)
+    {
+      bits[i] = (words[i / 64] >> (i % 64)) & 1;
+    }
+    return *this;
+  }
+
+  template <typename Rep, typename Period>
+  Deserializer &operator>>(std::chrono::duration<Rep, Period> &duration)
+  {
+    if constexpr (std::is_integral_v<Rep>)
+    {
+      if (m_time_encoding != time_encoding::fixed)
+      {
+        duration = std::chrono::duration<Rep, Period>(
+            static_cast<Rep>(m_buffer.read_svarint()));
+        return *this;
+      }
+    }
+    duration = std::chrono::duration<Rep, Period>(m_buffer.read<Rep>());
+    return *this;
+  }
+
+  template <typename Clock, typename Duration>
+  Deserializer &operator>>(std::chrono::time_point<Clock, Duration> &time)
+  {
+    using Rep = typename Duration::rep;
+    if constexpr (std::is_integral_v<Rep>)
+    {
+      if (m_time_encoding == time_encoding::delta)
+      {
+        m_last_time = static_cast<int64_t>(
+            static_cast<uint64_t>(m_last_time) +
+            static_cast<uint64_t>(m_buffer.read_svarint()));
+        time = std::chrono::time_point<Clock, Duration>(
+            Duration(static_cast<Rep>(m_last_time)));
+        return *this;
+      }
+    }
+    Duration since_epoch;
+    *this >> since_epoch;
+    time = std::chrono::time_point<Clock, Duration>(since_epoch);
+    return *this;
+  }
+
+  template <typename T, typename A>
+  Deserializer &operator>>(std::deque<T, A> &deq)
+  {
+    auto count = m_buffer.read<uint32_t>();
+    if (count > remaining() / (std::is_arithmetic_v<T> ? sizeof(T) : 1))
+    {
+      throw std::runtime_error("Sequence extends beyond buffer");
+    }
+    deq.resize(count);
+    for (size_t i = 0; i < deq.size();)
+    {
+      if constexpr (std::is_arithmetic_v<T>)
+      {
+        T *run = &deq[i];
+        size_t length = 1;
+        while (i + length < deq.size() && &deq[i + length] == run + length)
+        {
+          ++length;
+        }
+        m_buffer.read_bulk(run, length);
+        i += length;
+      }
+      else
+      {
+        *this >> deq[i++];
+      }
+    }
+    return *this;
+  }
+
+  template <typename T, typename A>
+  Deserializer &operator>>(std::list<T, A> &list)
+  {
+    auto count = m_buffer.read<uint32_t>();
+    if (count > remaining() / (std::is_arithmetic_v<T> ? sizeof(T) : 1))
+    {
+      throw std::runtime_error("Sequence extends beyond buffer");
+    }
+    list.clear();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      *this >> list.emplace_back();
+    }
+    return *this;
+  }
+
+  template <typename K, typename V>
+  Deserializer &operator>>(std::map<K, V> &map)
+  {
+    map.clear();
+    read_entries(map);
+    return *this;
+  }
+
+  template <typename K, typename V>
+  Deserializer &operator>>(std::unordered_map<K, V> &map)
+  {
+    map.clear();
+    read_entries(map);
+    return *this;
+  }
+
+  // New objects are registered before their contents are read, so
+  // self-referencing graphs resolve to the same instance.
+  template <typename T> Deserializer &operator>>(std::shared_ptr<T> &ptr)
+  {
+    const uint64_t id = m_buffer.read_varint();
+    if (id == 0)
+    {
+      ptr.reset();
+    }
+    else if (id <= m_shared_objects.size())
+    {
+      const shared_object &entry = m_shared_objects[id - 1];
+      if (entry.type != std::type_index(typeid(std::remove_const_t<T>)))
+      {
+        throw std::runtime_error("Shared object reference has wrong type");
+      }
+      ptr = std::static_pointer_cast<T>(entry.object);
+    }
+    else if (id == m_shared_objects.size() + 1)
+    {
+      auto object = std::make_shared<std::remove_const_t<T>>();
+      m_shared_objects.push_back(
+          shared_object{object, typeid(std::remove_const_t<T>)});
+      *this >> *object;
+      ptr = std::move(object);
+    }
+    else
+    {
+      throw std::runtime_error("Invalid shared object reference");
+    }
+    return *this;
+  }
+
+  template <typename T> Deserializer &operator>>(std::unique_ptr<T> &ptr)
+  {
+    if (m_buffer.read<uint8_t>() == 0)
+    {
+      ptr.reset();
+      return *this;
+    }
+    auto object = std::make_unique<T>();
+    *this >> *object;
+    ptr = std::move(object);
+    return *this;
+  }
+
+  template <typename T> Deserializer &read_quantized(std::vector<T> &vec)
+  {
+    vec = m_buffer.read_quantized_array<T>();
+    return *this;
+  }
+
+  Deserializer &read_varint(uint64_t &value)
+  {
+    value = m_buffer.read_varint();
+    return *this;
+  }
+
+  Deserializer &read_svarint(int64_t &value)
+  {
+    value = m_buffer.read_svarint();
+    return *this;
+  }
+
+  // Canonical mode rejects non-minimal varints, maps whose keys are not
+  // strictly ascending and bitsets with padding bits set.
+  void set_canonical(bool canonical)
+  {
+    m_buffer.set_canonical(canonical);
+  }
+
+  void set_time_encoding(time_encoding encoding)
+  {
+    m_time_encoding = encoding;
+  }
+
+  // Backs make() with a monotonic arena owned by this decoder: strings and
+  // vectors of a message are carved out of a few large blocks instead of
+  // individual heap allocations, and release_arena() frees them at once.
+  void use_arena(size_t initial_size = 4096)
+  {
+    m_arena = std::make_shared<std::pmr::monotonic_buffer_resource>(
+        initial_size);
+  }
+
+  std::pmr::memory_resource *memory_resource() const
+  {
+    return m_arena ? m_arena.get() : std::pmr::get_default_resource();
+  }
+
+  // Empty pmr container (std::pmr::string, std::pmr::vector<...>) bound to
+  // this decoder's memory resource; nested pmr elements inherit it.
+  template <typename T> T make() const
+  {
+    return T(typename T::allocator_type(memory_resource()));
+  }
+
+  // Containers from make() must be destroyed or no longer used first.
+  void release_arena()
+  {
+    if (m_arena)
+      m_arena->release();
+  }
+
+  // Rejects strings that are not well-formed UTF-8 as they are decoded.
+  void set_validate_utf8(bool validate)
+  {
+    m_buffer.set_validate_utf8(validate);
+  }
+
+  // Advances past a value of type T without constructing it: arithmetic
+  // values and arrays of them are skipped by width, strings by their length
+  // prefix.
+  template <typename T> Deserializer &skip()
+  {
+    if constexpr (std::is_arithmetic_v<T> || is_complex_v<T> ||
+                  is_trivially_serializable_v<T>)
+    {
+      m_buffer.read_bytes(sizeof(T));
+    }
+    else if constexpr (std::is_same_v<T, std::string> ||
+                       std::is_same_v<T, std::string_view>)
+    {
+      m_buffer.read_bytes(m_buffer.read<uint32_t>());
+    }
+    else
+    {
+      skip_sequence(static_cast<T *>(nullptr));
+    }
+    return *this;
+  }
+
+  Deserializer &skip_bytes(size_t count)
+  {
+    m_buffer.read_bytes(count);
+    return *this;
+  }
+
+  bool has_more() const
+  {
+    return m_buffer.position() < m_buffer.size();
+  }
+  size_t remaining() const
+  {
+    return m_buffer.size() - m_buffer.position();
+  }
+  size_t position() const
+  {
+    return m_buffer.position();
+  }
+  void set_position(size_t pos)
+  {
+    m_buffer.set_position(pos);
+  }
+
+private:
+  template <typename T> void read_custom(T &value)
+  {
+    if constexpr (extension_detail::has_member_deserialize<T>::value)
+    {
+      value.deserialize(*this);
+    }
+    else if constexpr (extension_detail::has_adl_deserialize<T>::value)
+    {
+      deserialize(*this, value);
+    }
+    else
+    {
+      static_assert(extension_detail::dependent_false<T>,
+                    "Type is not deserializable: provide deserialize() or "
+                    "specialize is_trivially_serializable");
+    }
+  }
+
+  template <typename T> void read_trivial(T *values, size_t count)
+  {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Trivially serializable types must be trivially copyable");
+
+    if (count == 0)
+      return;
+
+    if (m_buffer.get_endianness() == get_system_endianness())
+    {
+      if (count > remaining() / sizeof(T))
+      {
+        throw std::runtime_error("Buffer underflow");
+      }
+      std::memcpy(static_cast<void *>(values),
+                  m_buffer.read_bytes(count * sizeof(T)), count * sizeof(T));
+    }
+    else if constexpr (extension_detail::has_element_type<T>::value)
+    {
+      using E = typename is_trivially_serializable<T>::element_type;
+      m_buffer.read_bulk(reinterpret_cast<E *>(values),
+                         count * (sizeof(T) / sizeof(E)));
+    }
+    else if constexpr (extension_detail::has_member_deserialize<T>::value ||
+                       extension_detail::has_adl_deserialize<T>::value)
+    {
+      for (size_t i = 0; i < count; ++i)
+      {
+        read_custom(values[i]);
+      }
+    }
+    else
+    {
+      throw std::runtime_error(
+          "Trivially serializable type requires native byte order");
+    }
+  }
+
+  template <typename T> void skip_sequence(std::vector<T> *)
+  {
+    skip_elements<T>();
+  }
+
+  template <typename T, size_t N> void skip_sequence(std::array<T, N> *)
+  {
+    skip_elements<T>();
+  }
+
+  template <typename T, size_t N> void skip_sequence(static_vector<T, N> *)
+  {
+    skip_elements<T>();
+  }
+
+  template <typename T, typename A> void skip_sequence(std::deque<T, A> *)
+  {
+    skip_elements<T>();
+  }
+
+  template <typename T, typename A> void skip_sequence(std::list<T, A> *)
+  {
+    skip_elements<T>();
+  }
+
+  template <size_t N> void skip_sequence(fixed_string<N> *)
+  {
+    skip_elements<char>();
+  }
+
+  template <typename T> void skip_elements()
+  {
+    auto count = m_buffer.read<uint32_t>();
+    if constexpr (std::is_arithmetic_v<T> || is_complex_v<T> ||
+                  is_trivially_serializable_v<T>)
+    {
+      if (count > remaining() / sizeof(T))
+      {
+        throw std::runtime_error("Array extends beyond buffer");
+      }
+      m_buffer.read_bytes(count * sizeof(T));
+    }
+    else
+    {
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        skip<T>();
+      }
+    }
+  }
+
+  template <typename Map> void read_entries(Map &map)
+  {
+    auto count = m_buffer.read<uint32_t>();
+    const typename Map::key_type *previous = nullptr;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      typename Map::key_type key;
+      typename Map::mapped_type value;
+      *this >> key >> value;
+      if (m_buffer.is_canonical() && previous && !(*previous < key))
+      {
+        throw std::runtime_error("Map keys not in canonical order");
+      }
+      auto result = map.emplace(std::move(key), std::move(value));
+      if (!result.second)
+      {
+        throw std::runtime_error("Duplicate map key");
+      }
+      previous = &result.first->first;
+    }
   }
 };
 
@@ -0,0 +1,267 @@
+#pragma once
+
+#include "binary_serializer.hpp"
+
+namespace binary_serializer
+{
+
+// Binary patch between two encoded snapshots. A patch starts with the base
+// size, base hash and target size, followed by copy operations (ranges of the
+// base) and insert operations (literal bytes). Offsets and lengths are
+// varints.
+namespace delta_detail
+{
+
+enum class op : uint8_t
+{
+  copy = 0,
+  insert = 1
+};
+
+constexpr uint64_t hash_multiplier = 0x100000001b3ULL;
+constexpr size_t min_match = 8;
+
+// Length of the common prefix of `a` and `b`, compared a word at a time.
+inline size_t match_length(const uint8_t *a, const uint8_t *b, size_t limit)
+{
+  size_t length = 0;
+  while (length + sizeof(uint64_t) <= limit)
+  {
+    uint64_t wa, wb;
+    std::memcpy(&wa, a + length, sizeof(uint64_t));
+    std::memcpy(&wb, b + length, sizeof(uint64_t));
+    if (wa != wb)
+      break;
+    length += sizeof(uint64_t);
+  }
+  while (length < limit && a[length] == b[length])
+  {
+    ++length;
+  }
+  return length;
+}
+
+inline uint64_t block_hash(const uint8_t *bytes, size_t count)
+{
+  uint64_t hash = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    hash = hash * hash_multiplier + bytes[i];
+  }
+  return hash;
+}
+
+class patch_writer
+{
+private:
+  Buffer &m_out;
+  const uint8_t *m_target;
+  size_t m_literal_start = 0;
+  size_t m_copy_offset = 0;
+  size_t m_copy_length = 0;
+
+public:
+  patch_writer(Buffer &out, const uint8_t *target) : m_out(out), m_target(target)
+  {}
+
+  void copy(size_t target_pos, size_t base_offset, size_t length)
+  {
+    flush_literal(target_pos);
+    if (m_copy_length > 0 && m_copy_offset + m_copy_length == base_offset)
+    {
+      m_copy_length += length;
+    }
+    else
+    {
+      flush_copy();
+      m_copy_offset = base_offset;
+      m_copy_length = length;
+    }
+    m_literal_start = target_pos + length;
+  }
+
+  void finish(size_t target_size)
+  {
+    flush_literal(target_size);
+    flush_copy();
+  }
+
+private:
+  void flush_literal(size_t end)
+  {
+    if (end == m_literal_start)
+      return;
+    flush_copy();
+    m_out.write<uint8_t>(static_cast<uint8_t>(op::insert));
+    m_out.write_varint(end - m_literal_start);
+    m_out.write_bytes(m_target + m_literal_start, end - m_literal_start);
+    m_literal_start = end;
+  }
+
+  void flush_copy()
+  {
+    if (m_copy_length == 0)
+      return;
+    m_out.write<uint8_t>(static_cast<uint8_t>(op::copy));
+    m_out.write_varint(m_copy_offset);
+    m_out.write_varint(m_copy_length);
+    m_copy_length = 0;
+  }
+};
+
+} // namespace delta_detail
+
+// Builds a patch that turns `base` into `target`. Unchanged regions at the
+// same offset are found by direct comparison; moved regions are located by
+// hashing `block_size` blocks of the base and rolling the same hash over the
+// target.
+inline std::vector<uint8_t> make_patch(const std::vector<uint8_t> &base,
+                                       const std::vector<uint8_t> &target,
+                                       size_t block_size = 32)
+{
+  using namespace delta_detail;
+
+  if (block_size < min_match)
+  {
+    throw std::invalid_argument("Delta block size too small");
+  }
+
+  Buffer out(endianness::little);
+  out.write_varint(base.size());
+  out.write<uint64_t>(fnv1a_64(base.data(), base.size()));
+  out.write_varint(target.size());
+
+  std::unordered_map<uint64_t, size_t> blocks;
+  if (base.size() >= block_size)
+  {
+    blocks.reserve(base.size() / block_size);
+    for (size_t offset = 0; offset + block_size <= base.size();
+         offset += block_size)
+    {
+      blocks.emplace(block_hash(base.data() + offset, block_size), offset);
+    }
+  }
+
+  uint64_t top_power = 1;
+  for (size_t i = 1; i < block_size; ++i)
+  {
+    top_power *= hash_multiplier;
+  }
+
+  patch_writer writer(out, target.data());
+  const size_t size = target.size();
+  size_t pos = 0;
+  size_t hash_pos = SIZE_MAX;
+  uint64_t hash = 0;
+
+  while (pos < size)
+  {
+    if (pos < base.size())
+    {
+      const size_t length = match_length(base.data() + pos, target.data() + pos,
+                                         std::min(base.size(), size) - pos);
+      if (length >= min_match)
+      {
+        writer.copy(pos, pos, length);
+        pos += length;
+        continue;
+      }
+    }
+
+    if (!blocks.empty() && pos + block_size <= size)
+    {
+      if (hash_pos != SIZE_MAX && hash_pos + 1 == pos)
+      {
+        hash = (hash - target[pos - 1] * top_power) * hash_multiplier +
+               target[pos + block_size - 1];
+      }
+      else
+      {
+        hash = block_hash(target.data() + pos, block_size);
+      }
+      hash_pos = pos;
+
+      auto it = blocks.find(hash);
+      if (it != blocks.end())
+      {
+        const size_t offset = it->second;
+        const size_t length =
+            match_length(base.data() + offset, target.data() + pos,
+                         std::min(base.size() - offset, size - pos));
+        if (length >= block_size)
+        {
+          writer.copy(pos, offset, length);
+          pos += length;
+          continue;
+        }
+      }
+    }
+    ++pos;
+  }
+  writer.finish(size);
+  return out.vector();
+}
+
+inline std::vector<uint8_t> apply_patch(const std::vector<uint8_t> &base,
+                                        const std::vector<uint8_t> &patch)
+{
+  using namespace delta_detail;
+
+  Buffer in(patch, endianness::little);
+  const uint64_t base_size = in.read_varint();
+  const uint64_t base_hash = in.read<uint64_t>();
+  const uint64_t target_size = in.read_varint();
+  if (base_size != base.size() ||
+      base_hash != fnv1a_64(base.data(), base.size()))
+  {
+    throw std::runtime_error("Patch does not match base");
+  }
+
+  // target_size comes from the patch, so cap the reservation; repeated
+  // copies can still grow the result past it.
+  std::vector<uint8_t> result;
+  result.reserve(static_cast<size_t>(
+      std::min<uint64_t>(target_size, base.size() + patch.size())));
+  while (in.position() < in.size())
+  {
+    const auto kind = static_cast<op>(in.read<uint8_t>());
+    if (kind == op::copy)
+    {
+      const uint64_t offset = in.read_varint();
+      const uint64_t length = in.read_varint();
+      if (offset > base.size() || length > base.size() - offset)
+      {
+        throw std::runtime_error("Patch copy beyond base");
+      }
+      result.insert(result.end(), base.begin() + static_cast<std::ptrdiff_t>(offset),
+                    base.begin() + static_cast<std::ptrdiff_t>(offset + length));
+    }
+    else if (kind == op::insert)
+    {
+      const uint64_t length = in.read_varint();
+      if (length > in.size() - in.position())
+      {
+        throw std::runtime_error("Patch literal beyond buffer");
+      }
+      const uint8_t *bytes = in.read_bytes(static_cast<size_t>(length));
+      result.insert(result.end(), bytes, bytes + length);
+    }
+    else
+    {
+      throw std::runtime_error("Invalid patch operation");
+    }
+
+    if (result.size() > target_size)
+    {
+      throw std::runtime_error("Patch exceeds target size");
+    }
+  }
+
+  if (result.size() != target_size)
+  {
+    throw std::runtime_error("Patch target size mismatch");
+  }
+  return result;
+}
+
+}
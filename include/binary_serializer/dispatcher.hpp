@@ -0,0 +1,156 @@
+#pragma once
+
+#include "binary_serializer.hpp"
+
+#include <functional>
+
+namespace binary_serializer
+{
+
+// A frame is a varint type ID, a varint payload length and the payload.
+inline void write_frame(Serializer &out, uint32_t type_id,
+                        const uint8_t *payload, size_t size)
+{
+  out.write_varint(type_id);
+  out.write_varint(size);
+  out.write_bytes(payload, size);
+}
+
+inline void write_frame(Serializer &out, uint32_t type_id,
+                        const Serializer &payload)
+{
+  const Buffer &buffer = payload.get_buffer();
+  write_frame(out, type_id, buffer.data(), buffer.size());
+}
+
+// Routes framed messages to handlers by type ID. Handlers receive a
+// Deserializer reading the payload in place, so nothing is copied and only
+// the fields a handler reads are decoded. Handlers live in a flat table
+// indexed by ID, so IDs are capped at max_id.
+class Dispatcher
+{
+public:
+  using handler = std::function<void(Deserializer &)>;
+
+  static constexpr uint32_t max_id = 0xFFFF;
+
+private:
+  struct frame
+  {
+    uint32_t type_id;
+    byte_view payload;
+  };
+
+  endianness m_endianness;
+  std::vector<handler> m_handlers;
+  std::vector<frame> m_frames;
+  std::vector<std::vector<byte_view>> m_batches;
+
+public:
+  explicit Dispatcher(endianness endian = endianness::native)
+      : m_endianness(endian)
+  {}
+
+  void on(uint32_t type_id, handler fn)
+  {
+    if (type_id > max_id)
+    {
+      throw std::invalid_argument("Type ID exceeds dispatcher limit");
+    }
+    if (type_id >= m_handlers.size())
+    {
+      m_handlers.resize(type_id + 1);
+    }
+    m_handlers[type_id] = std::move(fn);
+  }
+
+  // Decodes the whole payload into a T before calling `fn(const T &)`.
+  template <typename T, typename F> void on(uint32_t type_id, F fn)
+  {
+    on(type_id, [fn = std::move(fn)](Deserializer &deserializer)
+       {
+         T value{};
+         deserializer >> value;
+         fn(value);
+       });
+  }
+
+  bool has_handler(uint32_t type_id) const
+  {
+    return type_id < m_handlers.size() && m_handlers[type_id];
+  }
+
+  // Invokes handlers in stream order; returns the number of messages.
+  size_t dispatch(byte_view frames)
+  {
+    parse(frames);
+    for (const frame &message : m_frames)
+    {
+      invoke(message.type_id, message.payload);
+    }
+    return m_frames.size();
+  }
+
+  // Groups messages by type and runs each handler over its whole group, so
+  // the same handler code stays hot. Order is preserved within a type only.
+  size_t dispatch_batched(byte_view frames)
+  {
+    parse(frames);
+    if (m_batches.size() < m_handlers.size())
+    {
+      m_batches.resize(m_handlers.size());
+    }
+    // A handler that threw last time leaves views into that call's frames
+    // behind; they must never be replayed.
+    for (auto &batch : m_batches)
+    {
+      batch.clear();
+    }
+    for (const frame &message : m_frames)
+    {
+      m_batches[message.type_id].push_back(message.payload);
+    }
+    for (size_t type_id = 0; type_id < m_batches.size(); ++type_id)
+    {
+      auto &batch = m_batches[type_id];
+      for (const byte_view &payload : batch)
+      {
+        invoke(static_cast<uint32_t>(type_id), payload);
+      }
+      batch.clear();
+    }
+    return m_frames.size();
+  }
+
+private:
+  // Validates every frame header before any handler runs.
+  void parse(byte_view frames)
+  {
+    m_frames.clear();
+    Buffer reader(frames, m_endianness);
+    while (reader.position() < reader.size())
+    {
+      const uint64_t type_id = reader.read_varint();
+      const uint64_t size = reader.read_varint();
+      if (type_id > UINT32_MAX || !has_handler(static_cast<uint32_t>(type_id)))
+      {
+        throw std::runtime_error("No handler for type ID");
+      }
+      if (size > reader.size() - reader.position())
+      {
+        throw std::runtime_error("Frame extends beyond buffer");
+      }
+      const uint8_t *payload = reader.read_bytes(static_cast<size_t>(size));
+      m_frames.push_back(frame{static_cast<uint32_t>(type_id),
+                               byte_view(payload, static_cast<size_t>(size))});
+    }
+  }
+
+  void invoke(uint32_t type_id, byte_view payload)
+  {
+    Deserializer deserializer(payload, m_endianness);
+    m_handlers[type_id](deserializer);
+  }
+};
+
+}
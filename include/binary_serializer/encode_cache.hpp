@@ -0,0 +1,164 @@
+#pragma once
+
+#include "binary_serializer.hpp"
+
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace binary_serializer
+{
+
+// Stores the encoded bytes of immutable objects keyed by object address and
+// a caller supplied version. Owners must bump the version (or erase the
+// entry) whenever the object changes or is destroyed. Encodings that depend
+// on stream state (shared_ptr IDs, delta-encoded time points) are never
+// cached; such objects get an entry without bytes so later writes skip the
+// trial encoding. See write_cached.
+class EncodeCache
+{
+public:
+  using bytes_ptr = std::shared_ptr<const std::vector<uint8_t>>;
+
+private:
+  struct entry
+  {
+    uint64_t version;
+    endianness endian;
+    bool canonical;
+    time_encoding times;
+    bytes_ptr bytes; // null when the encoding cannot be cached
+  };
+
+  mutable std::mutex m_mutex;
+  std::unordered_map<const void *, entry> m_entries;
+  size_t m_hits = 0;
+  size_t m_misses = 0;
+
+public:
+  // Empty on a miss; holds a null pointer when the object was marked
+  // uncacheable for these settings.
+  std::optional<bytes_ptr> lookup(const void *identity, uint64_t version,
+                                  endianness endian, bool canonical,
+                                  time_encoding times = time_encoding::fixed)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(identity);
+    if (it == m_entries.end() || it->second.version != version ||
+        it->second.endian != endian || it->second.canonical != canonical ||
+        it->second.times != times)
+    {
+      ++m_misses;
+      return std::nullopt;
+    }
+    ++m_hits;
+    return it->second.bytes;
+  }
+
+  bytes_ptr find(const void *identity, uint64_t version, endianness endian,
+                 bool canonical, time_encoding times = time_encoding::fixed)
+  {
+    return lookup(identity, version, endian, canonical, times)
+        .value_or(nullptr);
+  }
+
+  bytes_ptr insert(const void *identity, uint64_t version, endianness endian,
+                   bool canonical, std::vector<uint8_t> bytes,
+                   time_encoding times = time_encoding::fixed)
+  {
+    auto shared = std::make_shared<const std::vector<uint8_t>>(std::move(bytes));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[identity] = entry{version, endian, canonical, times, shared};
+    return shared;
+  }
+
+  void mark_uncacheable(const void *identity, uint64_t version,
+                        endianness endian, bool canonical,
+                        time_encoding times = time_encoding::fixed)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[identity] = entry{version, endian, canonical, times, nullptr};
+  }
+
+  void erase(const void *identity)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.erase(identity);
+  }
+
+  void clear()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_hits = 0;
+    m_misses = 0;
+  }
+
+  size_t size() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+  }
+  size_t hits() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+  }
+  size_t misses() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+  }
+};
+
+// Splices the cached encoding of `object` into `serializer`, running
+// `encode(Serializer &, const T &)` only on a miss. When the fresh encoding
+// turns out to number shared objects or delta-encode time points, it would
+// not decode correctly inside another stream, so the object is encoded
+// directly into `serializer` and marked uncacheable; later writes of the
+// same version encode directly without the trial encoding.
+template <typename T, typename Encode>
+Serializer &write_cached(Serializer &serializer, EncodeCache &cache,
+                         const T &object, uint64_t version, Encode &&encode)
+{
+  const Buffer &buffer = serializer.get_buffer();
+  const endianness endian = buffer.get_endianness();
+  const bool canonical = buffer.is_canonical();
+  const time_encoding times = serializer.get_time_encoding();
+
+  auto cached = cache.lookup(&object, version, endian, canonical, times);
+  if (cached && !*cached)
+  {
+    encode(serializer, object);
+    return serializer;
+  }
+
+  EncodeCache::bytes_ptr bytes = cached ? *cached : nullptr;
+  if (!bytes)
+  {
+    Serializer encoder(endian);
+    encoder.set_canonical(canonical);
+    encoder.set_time_encoding(times);
+    encode(encoder, object);
+    if (encoder.has_stream_state())
+    {
+      cache.mark_uncacheable(&object, version, endian, canonical, times);
+      encode(serializer, object);
+      return serializer;
+    }
+    bytes = cache.insert(&object, version, endian, canonical,
+                         encoder.get_data(), times);
+  }
+  return serializer.write_bytes(bytes->data(), bytes->size());
+}
+
+template <typename T>
+Serializer &write_cached(Serializer &serializer, EncodeCache &cache,
+                         const T &object, uint64_t version)
+{
+  return write_cached(serializer, cache, object, version,
+                      [](Serializer &encoder, const T &value)
+                      { encoder << value; });
+}
+
+}
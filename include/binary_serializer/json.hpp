@@ -0,0 +1,568 @@
+#pragma once
+
+#include "schema.hpp"
+
+#include <charconv>
+#include <ostream>
+
+namespace binary_serializer
+{
+
+// Schema-driven transcoding between binary records and JSON objects.
+// Numbers are formatted with std::to_chars (shortest round-trip form for
+// floats); non-finite floats become null and null reads back as NaN.
+namespace json_detail
+{
+
+inline void append_escaped(std::string &out, std::string_view str)
+{
+  static const char hex[] = "0123456789abcdef";
+
+  out += '"';
+  size_t run = 0;
+  for (size_t i = 0; i < str.size(); ++i)
+  {
+    const auto c = static_cast<unsigned char>(str[i]);
+    if (c >= 0x20 && c != '"' && c != '\\')
+    {
+      continue;
+    }
+    out.append(str.data() + run, i - run);
+    run = i + 1;
+    switch (c)
+    {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      out += "\\u00";
+      out += hex[c >> 4];
+      out += hex[c & 0xF];
+    }
+  }
+  out.append(str.data() + run, str.size() - run);
+  out += '"';
+}
+
+template <typename T> void append_number(std::string &out, T value)
+{
+  if constexpr (std::is_same_v<T, bool>)
+  {
+    out += value ? "true" : "false";
+  }
+  else
+  {
+    if constexpr (std::is_floating_point_v<T>)
+    {
+      if (!std::isfinite(value))
+      {
+        out += "null";
+        return;
+      }
+    }
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+  }
+}
+
+inline void append_value(std::string &out, Deserializer &in, field_type type)
+{
+  if (type == field_type::string)
+  {
+    std::string_view str;
+    in >> str;
+    append_escaped(out, str);
+    return;
+  }
+  visit_scalar(type, [&](auto tag)
+               {
+                 typename decltype(tag)::type value;
+                 in >> value;
+                 append_number(out, value);
+               });
+}
+
+class parser
+{
+private:
+  std::string_view m_text;
+  size_t m_pos = 0;
+
+public:
+  explicit parser(std::string_view text) : m_text(text)
+  {}
+
+  bool at_end()
+  {
+    skip_whitespace();
+    return m_pos >= m_text.size();
+  }
+
+  char peek()
+  {
+    if (at_end())
+    {
+      fail();
+    }
+    return m_text[m_pos];
+  }
+
+  bool consume(char c)
+  {
+    if (peek() != c)
+    {
+      return false;
+    }
+    ++m_pos;
+    return true;
+  }
+
+  void expect(char c)
+  {
+    if (!consume(c))
+    {
+      fail();
+    }
+  }
+
+  // Skips one value (validating its syntax) and returns its source text.
+  std::string_view skip_value()
+  {
+    const char c = peek();
+    const size_t start = m_pos;
+    if (c == '"')
+    {
+      std::string ignored;
+      parse_string(ignored);
+    }
+    else if (c == '[' || c == '{')
+    {
+      const char close = c == '[' ? ']' : '}';
+      ++m_pos;
+      if (!consume(close))
+      {
+        do
+        {
+          if (c == '{')
+          {
+            std::string ignored;
+            parse_string(ignored);
+            expect(':');
+          }
+          skip_value();
+        } while (consume(','));
+        expect(close);
+      }
+    }
+    else
+    {
+      parse_token();
+    }
+    return m_text.substr(start, m_pos - start);
+  }
+
+  void parse_string(std::string &out)
+  {
+    expect('"');
+    out.clear();
+    while (true)
+    {
+      if (m_pos >= m_text.size())
+      {
+        fail();
+      }
+      const char c = m_text[m_pos++];
+      if (c == '"')
+      {
+        return;
+      }
+      if (c != '\\')
+      {
+        out += c;
+        continue;
+      }
+      if (m_pos >= m_text.size())
+      {
+        fail();
+      }
+      const char escape = m_text[m_pos++];
+      switch (escape)
+      {
+      case '"':
+      case '\\':
+      case '/':
+        out += escape;
+        break;
+      case 'b':
+        out += '\b';
+        break;
+      case 'f':
+        out += '\f';
+        break;
+      case 'n':
+        out += '\n';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case 't':
+        out += '\t';
+        break;
+      case 'u':
+        append_code_point(out, parse_unicode_escape());
+        break;
+      default:
+        fail();
+      }
+    }
+  }
+
+  // Number, true, false or null.
+  std::string_view parse_token()
+  {
+    peek();
+    const size_t start = m_pos;
+    while (m_pos < m_text.size() && m_text[m_pos] != ',' &&
+           m_text[m_pos] != ']' && m_text[m_pos] != '}' &&
+           !is_whitespace(m_text[m_pos]))
+    {
+      ++m_pos;
+    }
+    if (m_pos == start)
+    {
+      fail();
+    }
+    return m_text.substr(start, m_pos - start);
+  }
+
+  [[noreturn]] static void fail()
+  {
+    throw std::runtime_error("Invalid JSON");
+  }
+
+private:
+  static bool is_whitespace(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+  void skip_whitespace()
+  {
+    while (m_pos < m_text.size() && is_whitespace(m_text[m_pos]))
+    {
+      ++m_pos;
+    }
+  }
+
+  uint32_t parse_hex4()
+  {
+    if (m_pos + 4 > m_text.size())
+    {
+      fail();
+    }
+    uint32_t value = 0;
+    auto result = std::from_chars(m_text.data() + m_pos,
+                                  m_text.data() + m_pos + 4, value, 16);
+    if (result.ptr != m_text.data() + m_pos + 4)
+    {
+      fail();
+    }
+    m_pos += 4;
+    return value;
+  }
+
+  uint32_t parse_unicode_escape()
+  {
+    uint32_t code = parse_hex4();
+    if (code >= 0xD800 && code <= 0xDBFF)
+    {
+      if (m_text.substr(m_pos, 2) != "\\u")
+      {
+        fail();
+      }
+      m_pos += 2;
+      const uint32_t low = parse_hex4();
+      if (low < 0xDC00 || low > 0xDFFF)
+      {
+        fail();
+      }
+      code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+    }
+    else if (code >= 0xDC00 && code <= 0xDFFF)
+    {
+      fail();
+    }
+    return code;
+  }
+
+  static void append_code_point(std::string &out, uint32_t code)
+  {
+    if (code < 0x80)
+    {
+      out += static_cast<char>(code);
+    }
+    else if (code < 0x800)
+    {
+      out += static_cast<char>(0xC0 | (code >> 6));
+      out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000)
+    {
+      out += static_cast<char>(0xE0 | (code >> 12));
+      out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else
+    {
+      out += static_cast<char>(0xF0 | (code >> 18));
+      out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+  }
+};
+
+template <typename T> T parse_number(std::string_view token)
+{
+  if constexpr (std::is_same_v<T, bool>)
+  {
+    if (token == "true")
+      return true;
+    if (token == "false")
+      return false;
+    parser::fail();
+  }
+  else
+  {
+    if constexpr (std::is_floating_point_v<T>)
+    {
+      if (token == "null")
+        return std::numeric_limits<T>::quiet_NaN();
+    }
+    T value;
+    auto result = std::from_chars(token.data(), token.data() + token.size(),
+                                  value);
+    if (result.ec != std::errc() || result.ptr != token.data() + token.size())
+    {
+      throw std::runtime_error("Invalid JSON number for field type");
+    }
+    return value;
+  }
+}
+
+inline void write_value(Serializer &out, parser &in, field_type type,
+                        std::string &scratch)
+{
+  if (type == field_type::string)
+  {
+    in.parse_string(scratch);
+    out << scratch;
+    return;
+  }
+  visit_scalar(type, [&](auto tag)
+               {
+                 using T = typename decltype(tag)::type;
+                 out << parse_number<T>(in.parse_token());
+               });
+}
+
+} // namespace json_detail
+
+// Appends one record from `in` to `out` as a JSON object.
+inline void record_to_json(const Schema &schema, Deserializer &in,
+                           std::string &out)
+{
+  out += '{';
+  for (size_t i = 0; i < schema.size(); ++i)
+  {
+    const field &f = schema[i];
+    if (i > 0)
+      out += ',';
+    json_detail::append_escaped(out, f.name);
+    out += ':';
+    if (f.type != field_type::array)
+    {
+      json_detail::append_value(out, in, f.type);
+      continue;
+    }
+
+    uint32_t count;
+    in >> count;
+    out += '[';
+    for (uint32_t j = 0; j < count; ++j)
+    {
+      if (j > 0)
+        out += ',';
+      json_detail::append_value(out, in, f.element);
+    }
+    out += ']';
+  }
+  out += '}';
+}
+
+// Writes back-to-back records as newline-delimited JSON, flushing `out` in
+// large chunks. Returns the number of records.
+inline size_t records_to_json(const Schema &schema, byte_view records,
+                              std::ostream &out,
+                              endianness endian = endianness::native)
+{
+  if (schema.size() == 0)
+  {
+    throw std::invalid_argument("Cannot transcode records of an empty schema");
+  }
+  constexpr size_t flush_size = 64 * 1024;
+
+  Deserializer in(records, endian);
+  std::string chunk;
+  chunk.reserve(flush_size + 4096);
+  size_t count = 0;
+  while (in.has_more())
+  {
+    record_to_json(schema, in, chunk);
+    chunk += '\n';
+    ++count;
+    if (chunk.size() >= flush_size)
+    {
+      out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+      chunk.clear();
+    }
+  }
+  out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+  return count;
+}
+
+namespace json_detail
+{
+
+inline void encode_record(const Schema &schema, std::string_view json,
+                          Serializer &out)
+{
+  json_detail::parser in(json);
+  std::vector<std::string_view> values(schema.size());
+  std::string key;
+
+  in.expect('{');
+  if (!in.consume('}'))
+  {
+    do
+    {
+      in.parse_string(key);
+      in.expect(':');
+      const std::string_view value = in.skip_value();
+      for (size_t i = 0; i < schema.size(); ++i)
+      {
+        if (schema[i].name == key)
+        {
+          values[i] = value;
+          break;
+        }
+      }
+    } while (in.consume(','));
+    in.expect('}');
+  }
+  if (!in.at_end())
+  {
+    json_detail::parser::fail();
+  }
+
+  for (size_t i = 0; i < schema.size(); ++i)
+  {
+    const field &f = schema[i];
+    if (values[i].empty())
+    {
+      throw std::runtime_error("Missing JSON field: " + f.name);
+    }
+
+    json_detail::parser value(values[i]);
+    if (f.type != field_type::array)
+    {
+      json_detail::write_value(out, value, f.type, key);
+      continue;
+    }
+
+    uint32_t count = 0;
+    json_detail::parser counter(values[i]);
+    counter.expect('[');
+    if (!counter.consume(']'))
+    {
+      do
+      {
+        counter.skip_value();
+        ++count;
+      } while (counter.consume(','));
+    }
+    out << count;
+
+    value.expect('[');
+    for (uint32_t j = 0; j < count; ++j)
+    {
+      if (j > 0)
+        value.expect(',');
+      json_detail::write_value(out, value, f.element, key);
+    }
+  }
+}
+
+// An empty serializer that encodes the same bytes as `out`, so records can
+// be staged and appended only once they are complete.
+inline Serializer staging_for(const Serializer &out)
+{
+  Serializer staged(out.get_buffer().get_endianness());
+  staged.set_canonical(out.get_buffer().is_canonical());
+  staged.set_time_encoding(out.get_time_encoding());
+  return staged;
+}
+
+} // namespace json_detail
+
+// Encodes one JSON object as a record. Keys may appear in any order;
+// unknown keys are ignored and missing ones are an error. On error `out` is
+// left unchanged.
+inline void json_to_record(const Schema &schema, std::string_view json,
+                           Serializer &out)
+{
+  Serializer staged = json_detail::staging_for(out);
+  json_detail::encode_record(schema, json, staged);
+  const Buffer &bytes = staged.get_buffer();
+  out.write_bytes(bytes.data(), bytes.size());
+}
+
+// Encodes newline-delimited JSON objects; blank lines are skipped. Either
+// every record is appended to `out` or, on error, none is.
+inline size_t json_to_records(const Schema &schema, std::string_view lines,
+                              Serializer &out)
+{
+  Serializer staged = json_detail::staging_for(out);
+  size_t count = 0;
+  while (!lines.empty())
+  {
+    const size_t end = lines.find('\n');
+    const std::string_view line = lines.substr(0, end);
+    if (line.find_first_not_of(" \t\r") != std::string_view::npos)
+    {
+      json_detail::encode_record(schema, line, staged);
+      ++count;
+    }
+    if (end == std::string_view::npos)
+      break;
+    lines.remove_prefix(end + 1);
+  }
+  const Buffer &bytes = staged.get_buffer();
+  out.write_bytes(bytes.data(), bytes.size());
+  return count;
+}
+
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "binary_serializer.hpp"
+
+namespace binary_serializer
+{
+
+// Order-preserving encoding: memcmp over two encoded keys gives the same
+// result as comparing the original values field by field. Integers are
+// big-endian with the sign bit flipped, floats use the IEEE total order
+// transform (-0.0 sorts before 0.0, NaN after infinity) and strings escape
+// 0x00 as 0x00 0xFF and end with 0x00 0x01 so shorter prefixes sort first.
+namespace key_detail
+{
+
+template <typename T> struct key_bits
+{
+  using type = std::make_unsigned_t<T>;
+};
+template <> struct key_bits<bool>
+{
+  using type = uint8_t;
+};
+template <> struct key_bits<float>
+{
+  using type = uint32_t;
+};
+template <> struct key_bits<double>
+{
+  using type = uint64_t;
+};
+
+template <typename T> typename key_bits<T>::type to_key(T value)
+{
+  using U = typename key_bits<T>::type;
+  constexpr U sign = U(1) << (8 * sizeof(U) - 1);
+
+  if constexpr (std::is_same_v<T, bool>)
+  {
+    return value ? 1 : 0;
+  }
+  else if constexpr (std::is_floating_point_v<T>)
+  {
+    U bits;
+    std::memcpy(&bits, &value, sizeof(T));
+    return (bits & sign) ? static_cast<U>(~bits) : static_cast<U>(bits ^ sign);
+  }
+  else if constexpr (std::is_signed_v<T>)
+  {
+    return static_cast<U>(static_cast<U>(value) ^ sign);
+  }
+  else
+  {
+    return value;
+  }
+}
+
+template <typename T> T from_key(typename key_bits<T>::type bits)
+{
+  using U = typename key_bits<T>::type;
+  constexpr U sign = U(1) << (8 * sizeof(U) - 1);
+
+  if constexpr (std::is_same_v<T, bool>)
+  {
+    return bits != 0;
+  }
+  else if constexpr (std::is_floating_point_v<T>)
+  {
+    bits = (bits & sign) ? static_cast<U>(bits ^ sign) : static_cast<U>(~bits);
+    T value;
+    std::memcpy(&value, &bits, sizeof(T));
+    return value;
+  }
+  else if constexpr (std::is_signed_v<T>)
+  {
+    return static_cast<T>(static_cast<U>(bits ^ sign));
+  }
+  else
+  {
+    return bits;
+  }
+}
+
+} // namespace key_detail
+
+class KeySerializer
+{
+private:
+  Buffer m_buffer;
+
+public:
+  KeySerializer() : m_buffer(endianness::big)
+  {}
+
+  template <typename T> KeySerializer &operator<<(T value)
+  {
+    static_assert(std::is_arithmetic_v<T>, "Type must be arithmetic");
+    m_buffer.write(key_detail::to_key(value));
+    return *this;
+  }
+
+  KeySerializer &operator<<(const std::string &str)
+  {
+    write_escaped(reinterpret_cast<const uint8_t *>(str.data()), str.size());
+    return *this;
+  }
+
+  KeySerializer &operator<<(const char *str)
+  {
+    write_escaped(reinterpret_cast<const uint8_t *>(str), std::strlen(str));
+    return *this;
+  }
+
+  const Buffer &get_buffer() const
+  {
+    return m_buffer;
+  }
+  std::vector<uint8_t> get_data() const
+  {
+    return m_buffer.vector();
+  }
+  void clear()
+  {
+    m_buffer.clear();
+  }
+
+private:
+  void write_escaped(const uint8_t *bytes, size_t length)
+  {
+    static const uint8_t escaped_zero[2] = {0x00, 0xFF};
+    static const uint8_t terminator[2] = {0x00, 0x01};
+
+    const uint8_t *end = bytes + length;
+    while (bytes < end)
+    {
+      const auto *zero = static_cast<const uint8_t *>(
+          std::memchr(bytes, 0, static_cast<size_t>(end - bytes)));
+      if (zero == nullptr)
+      {
+        m_buffer.write_bytes(bytes, static_cast<size_t>(end - bytes));
+        break;
+      }
+      m_buffer.write_bytes(bytes, static_cast<size_t>(zero - bytes));
+      m_buffer.write_bytes(escaped_zero, 2);
+      bytes = zero + 1;
+    }
+    m_buffer.write_bytes(terminator, 2);
+  }
+};
+
+class KeyDeserializer
+{
+private:
+  Buffer m_buffer;
+
+public:
+  explicit KeyDeserializer(std::vector<uint8_t> data)
+      : m_buffer(std::move(data), endianness::big)
+  {}
+
+  template <typename T> KeyDeserializer &operator>>(T &value)
+  {
+    static_assert(std::is_arithmetic_v<T>, "Type must be arithmetic");
+    using U = typename key_detail::key_bits<T>::type;
+    value = key_detail::from_key<T>(m_buffer.read<U>());
+    return *this;
+  }
+
+  KeyDeserializer &operator>>(std::string &str)
+  {
+    str.clear();
+    const uint8_t *data = m_buffer.data();
+    size_t pos = m_buffer.position();
+    const size_t size = m_buffer.size();
+
+    while (true)
+    {
+      const auto *zero = static_cast<const uint8_t *>(
+          std::memchr(data + pos, 0, size - pos));
+      if (zero == nullptr || zero + 1 >= data + size)
+      {
+        throw std::runtime_error("Unterminated key string");
+      }
+      const size_t zero_pos = static_cast<size_t>(zero - data);
+      str.append(reinterpret_cast<const char *>(data + pos), zero_pos - pos);
+      pos = zero_pos + 2;
+      if (zero[1] == 0x01)
+      {
+        break;
+      }
+      if (zero[1] != 0xFF)
+      {
+        throw std::runtime_error("Invalid key string escape");
+      }
+      str.push_back('\0');
+    }
+    m_buffer.set_position(pos);
+    return *this;
+  }
+
+  bool has_more() const
+  {
+    return m_buffer.position() < m_buffer.size();
+  }
+  size_t remaining() const
+  {
+    return m_buffer.size() - m_buffer.position();
+  }
+};
+
+}
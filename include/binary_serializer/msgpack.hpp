@@ -0,0 +1,593 @@
+#pragma once
+
+#include "binary_serializer.hpp"
+
+namespace binary_serializer
+{
+
+// MessagePack backend with the same stream operators as Serializer and
+// Deserializer. Integers use the smallest format that holds the value,
+// std::vector<uint8_t> maps to the bin family and maps are written in
+// iteration order.
+namespace msgpack_detail
+{
+
+enum marker : uint8_t
+{
+  nil = 0xc0,
+  false_value = 0xc2,
+  true_value = 0xc3,
+  bin8 = 0xc4,
+  bin16 = 0xc5,
+  bin32 = 0xc6,
+  float32 = 0xca,
+  float64 = 0xcb,
+  uint8 = 0xcc,
+  uint16 = 0xcd,
+  uint32 = 0xce,
+  uint64 = 0xcf,
+  int8 = 0xd0,
+  int16 = 0xd1,
+  int32 = 0xd2,
+  int64 = 0xd3,
+  str8 = 0xd9,
+  str16 = 0xda,
+  str32 = 0xdb,
+  array16 = 0xdc,
+  array32 = 0xdd,
+  map16 = 0xde,
+  map32 = 0xdf,
+  fixmap = 0x80,
+  fixarray = 0x90,
+  fixstr = 0xa0
+};
+
+} // namespace msgpack_detail
+
+class MsgPackSerializer
+{
+private:
+  Buffer m_buffer;
+
+public:
+  MsgPackSerializer() : m_buffer(endianness::big)
+  {}
+
+  template <typename T> MsgPackSerializer &operator<<(T value)
+  {
+    static_assert(std::is_arithmetic_v<T>, "Type must be arithmetic");
+
+    if constexpr (std::is_same_v<T, bool>)
+    {
+      m_buffer.write<uint8_t>(value ? msgpack_detail::true_value
+                                    : msgpack_detail::false_value);
+    }
+    else if constexpr (std::is_same_v<T, float>)
+    {
+      m_buffer.write<uint8_t>(msgpack_detail::float32);
+      m_buffer.write(value);
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+      m_buffer.write<uint8_t>(msgpack_detail::float64);
+      m_buffer.write(static_cast<double>(value));
+    }
+    else if constexpr (std::is_signed_v<T>)
+    {
+      write_signed(value);
+    }
+    else
+    {
+      write_unsigned(value);
+    }
+    return *this;
+  }
+
+  MsgPackSerializer &operator<<(std::nullptr_t)
+  {
+    m_buffer.write<uint8_t>(msgpack_detail::nil);
+    return *this;
+  }
+
+  MsgPackSerializer &operator<<(const std::string &str)
+  {
+    return write_str(str.data(), str.size());
+  }
+
+  MsgPackSerializer &operator<<(std::string_view str)
+  {
+    return write_str(str.data(), str.size());
+  }
+
+  MsgPackSerializer &operator<<(const char *str)
+  {
+    return write_str(str, std::strlen(str));
+  }
+
+  template <typename T, size_t N>
+  MsgPackSerializer &operator<<(const std::array<T, N> &arr)
+  {
+    return write_sequence(arr.data(), N);
+  }
+
+  template <typename T>
+  MsgPackSerializer &operator<<(const std::vector<T> &vec)
+  {
+    if constexpr (std::is_same_v<T, uint8_t>)
+    {
+      write_header(vec.size(), 0, msgpack_detail::bin8, msgpack_detail::bin16,
+                   msgpack_detail::bin32, 0);
+      m_buffer.write_bytes(vec.data(), vec.size());
+      return *this;
+    }
+    else
+    {
+      return write_sequence(vec.data(), vec.size());
+    }
+  }
+
+  template <typename K, typename V>
+  MsgPackSerializer &operator<<(const std::map<K, V> &map)
+  {
+    return write_entries(map);
+  }
+
+  template <typename K, typename V>
+  MsgPackSerializer &operator<<(const std::unordered_map<K, V> &map)
+  {
+    return write_entries(map);
+  }
+
+  // For hand-written heterogeneous arrays and maps: write the header, then
+  // the elements (key, value pairs for maps).
+  MsgPackSerializer &write_array_header(size_t count)
+  {
+    write_header(count, msgpack_detail::fixarray, 0, msgpack_detail::array16,
+                 msgpack_detail::array32, 16);
+    return *this;
+  }
+
+  MsgPackSerializer &write_map_header(size_t count)
+  {
+    write_header(count, msgpack_detail::fixmap, 0, msgpack_detail::map16,
+                 msgpack_detail::map32, 16);
+    return *this;
+  }
+
+  const Buffer &get_buffer() const
+  {
+    return m_buffer;
+  }
+  std::vector<uint8_t> get_data() const
+  {
+    return m_buffer.vector();
+  }
+  void clear()
+  {
+    m_buffer.clear();
+  }
+
+private:
+  void write_unsigned(uint64_t value)
+  {
+    if (value < 0x80)
+    {
+      m_buffer.write<uint8_t>(static_cast<uint8_t>(value));
+    }
+    else if (value <= UINT8_MAX)
+    {
+      m_buffer.write<uint8_t>(msgpack_detail::uint8);
+      m_buffer.write<uint8_t>(static_cast<uint8_t>(value));
+    }
+    else if (value <= UINT16_MAX)
+    {
+      m_buffer.write<uint8_t>(msgpack_detail::uint16);
+      m_buffer.write<uint16_t>(static_cast<uint16_t>(value));
+    }
+    else if (value <= UINT32_MAX)
+    {
+      m_buffer.write<uint8_t>(msgpack_detail::uint32);
+      m_buffer.write<uint32_t>(static_cast<uint32_t>(value));
+    }
+    else
+    {
+      m_buffer.write<uint8_t>(msgpack_detail::uint64);
+      m_buffer.write<uint64_t>(value);
+    }
+  }
+
+  void write_signed(int64_t value)
+  {
+    if (value >= 0)
+    {
+      write_unsigned(static_cast<uint64_t>(value));
+    }
+    else if (value >= -32)
+    {
+      m_buffer.write<int8_t>(static_cast<int8_t>(value));
+    }
+    else if (value >= INT8_MIN)
+    {
+      m_buffer.write<uint8_t>(msgpack_detail::int8);
+      m_buffer.write<int8_t>(static_cast<int8_t>(value));
+    }
+    else if (value >= INT16_MIN)
+    {
+      m_buffer.write<uint8_t>(msgpack_detail::int16);
+      m_buffer.write<int16_t>(static_cast<int16_t>(value));
+    }
+    else if (value >= INT32_MIN)
+    {
+      m_buffer.write<uint8_t>(msgpack_detail::int32);
+      m_buffer.write<int32_t>(static_cast<int32_t>(value));
+    }
+    else
+    {
+      m_buffer.write<uint8_t>(msgpack_detail::int64);
+      m_buffer.write<int64_t>(value);
+    }
+  }
+
+  // `fix_limit` is the exclusive bound for the fix* form (0 when the
+  // family has none); `marker8` is 0 when there is no 8-bit length form.
+  void write_header(size_t count, uint8_t fix, uint8_t marker8,
+                    uint8_t marker16, uint8_t marker32, size_t fix_limit)
+  {
+    if (count < fix_limit)
+    {
+      m_buffer.write<uint8_t>(static_cast<uint8_t>(fix | count));
+    }
+    else if (marker8 != 0 && count <= UINT8_MAX)
+    {
+      m_buffer.write<uint8_t>(marker8);
+      m_buffer.write<uint8_t>(static_cast<uint8_t>(count));
+    }
+    else if (count <= UINT16_MAX)
+    {
+      m_buffer.write<uint8_t>(marker16);
+      m_buffer.write<uint16_t>(static_cast<uint16_t>(count));
+    }
+    else if (count <= UINT32_MAX)
+    {
+      m_buffer.write<uint8_t>(marker32);
+      m_buffer.write<uint32_t>(static_cast<uint32_t>(count));
+    }
+    else
+    {
+      throw std::runtime_error("MessagePack length exceeds 32 bits");
+    }
+  }
+
+  MsgPackSerializer &write_str(const char *str, size_t length)
+  {
+    write_header(length, msgpack_detail::fixstr, msgpack_detail::str8,
+                 msgpack_detail::str16, msgpack_detail::str32, 32);
+    m_buffer.write_bytes(reinterpret_cast<const uint8_t *>(str), length);
+    return *this;
+  }
+
+  template <typename T>
+  MsgPackSerializer &write_sequence(const T *elements, size_t count)
+  {
+    write_array_header(count);
+    if constexpr (std::is_floating_point_v<T>)
+    {
+      // Every float carries a marker byte; reserve the exact size once.
+      m_buffer.reserve(m_buffer.size() +
+                       count * (1 + (std::is_same_v<T, float> ? 4 : 8)));
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+      *this << elements[i];
+    }
+    return *this;
+  }
+
+  template <typename Map> MsgPackSerializer &write_entries(const Map &map)
+  {
+    write_map_header(map.size());
+    for (const auto &entry : map)
+    {
+      *this << entry.first << entry.second;
+    }
+    return *this;
+  }
+};
+
+class MsgPackDeserializer
+{
+private:
+  Buffer m_buffer;
+
+public:
+  explicit MsgPackDeserializer(std::vector<uint8_t> data)
+      : m_buffer(std::move(data), endianness::big)
+  {}
+
+  explicit MsgPackDeserializer(byte_view data)
+      : m_buffer(data, endianness::big)
+  {}
+
+  template <typename T> MsgPackDeserializer &operator>>(T &value)
+  {
+    static_assert(std::is_arithmetic_v<T>, "Type must be arithmetic");
+
+    const uint8_t marker = m_buffer.read<uint8_t>();
+    if constexpr (std::is_same_v<T, bool>)
+    {
+      if (marker != msgpack_detail::true_value &&
+          marker != msgpack_detail::false_value)
+      {
+        throw std::runtime_error("MessagePack type mismatch");
+      }
+      value = marker == msgpack_detail::true_value;
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+      if (marker == msgpack_detail::float32)
+        value = static_cast<T>(m_buffer.read<float>());
+      else if (marker == msgpack_detail::float64)
+        value = static_cast<T>(m_buffer.read<double>());
+      else if (is_negative_integer(marker))
+        value = static_cast<T>(read_signed(marker));
+      else
+        value = static_cast<T>(read_unsigned(marker));
+    }
+    else
+    {
+      uint64_t unsigned_value;
+      if (is_negative_integer(marker))
+      {
+        const int64_t signed_value = read_signed(marker);
+        if (signed_value < 0)
+        {
+          if constexpr (std::is_signed_v<T>)
+          {
+            if (signed_value >= std::numeric_limits<T>::min())
+            {
+              value = static_cast<T>(signed_value);
+              return *this;
+            }
+          }
+          throw std::runtime_error("MessagePack integer out of range");
+        }
+        unsigned_value = static_cast<uint64_t>(signed_value);
+      }
+      else
+      {
+        unsigned_value = read_unsigned(marker);
+      }
+      if (unsigned_value > static_cast<uint64_t>(std::numeric_limits<T>::max()))
+      {
+        throw std::runtime_error("MessagePack integer out of range");
+      }
+      value = static_cast<T>(unsigned_value);
+    }
+    return *this;
+  }
+
+  MsgPackDeserializer &operator>>(std::string &str)
+  {
+    str = read_str();
+    return *this;
+  }
+
+  // Zero-copy; the view points into the deserializer's bytes.
+  MsgPackDeserializer &operator>>(std::string_view &str)
+  {
+    str = read_str();
+    return *this;
+  }
+
+  template <typename T, size_t N>
+  MsgPackDeserializer &operator>>(std::array<T, N> &arr)
+  {
+    if (read_array_header() != N)
+    {
+      throw std::runtime_error("Array size mismatch");
+    }
+    for (auto &element : arr)
+    {
+      *this >> element;
+    }
+    return *this;
+  }
+
+  template <typename T> MsgPackDeserializer &operator>>(std::vector<T> &vec)
+  {
+    if constexpr (std::is_same_v<T, uint8_t>)
+    {
+      const uint8_t marker = peek();
+      if (marker == msgpack_detail::bin8 || marker == msgpack_detail::bin16 ||
+          marker == msgpack_detail::bin32)
+      {
+        m_buffer.read<uint8_t>();
+        const size_t size = read_length(marker, msgpack_detail::bin8);
+        const uint8_t *bytes = m_buffer.read_bytes(size);
+        vec.assign(bytes, bytes + size);
+        return *this;
+      }
+    }
+
+    const size_t count = read_array_header();
+    if (count > remaining())
+    {
+      throw std::runtime_error("Array extends beyond buffer");
+    }
+    vec.clear();
+    vec.resize(count);
+    for (auto &element : vec)
+    {
+      *this >> element;
+    }
+    return *this;
+  }
+
+  template <typename K, typename V>
+  MsgPackDeserializer &operator>>(std::map<K, V> &map)
+  {
+    map.clear();
+    return read_entries(map);
+  }
+
+  template <typename K, typename V>
+  MsgPackDeserializer &operator>>(std::unordered_map<K, V> &map)
+  {
+    map.clear();
+    return read_entries(map);
+  }
+
+  size_t read_array_header()
+  {
+    const uint8_t marker = m_buffer.read<uint8_t>();
+    if ((marker & 0xF0) == msgpack_detail::fixarray)
+    {
+      return marker & 0x0F;
+    }
+    if (marker != msgpack_detail::array16 && marker != msgpack_detail::array32)
+    {
+      throw std::runtime_error("MessagePack type mismatch");
+    }
+    return read_length(marker, msgpack_detail::array16 - 1);
+  }
+
+  size_t read_map_header()
+  {
+    const uint8_t marker = m_buffer.read<uint8_t>();
+    if ((marker & 0xF0) == msgpack_detail::fixmap)
+    {
+      return marker & 0x0F;
+    }
+    if (marker != msgpack_detail::map16 && marker != msgpack_detail::map32)
+    {
+      throw std::runtime_error("MessagePack type mismatch");
+    }
+    return read_length(marker, msgpack_detail::map16 - 1);
+  }
+
+  // Consumes a nil and returns true, or leaves the input untouched.
+  bool read_nil()
+  {
+    if (peek() != msgpack_detail::nil)
+    {
+      return false;
+    }
+    m_buffer.read<uint8_t>();
+    return true;
+  }
+
+  bool has_more() const
+  {
+    return m_buffer.position() < m_buffer.size();
+  }
+  size_t remaining() const
+  {
+    return m_buffer.size() - m_buffer.position();
+  }
+
+private:
+  uint8_t peek() const
+  {
+    if (!has_more())
+    {
+      throw std::runtime_error("Buffer underflow");
+    }
+    return m_buffer.data()[m_buffer.position()];
+  }
+
+  // Lengths follow the marker as 8, 16 or 32-bit values; `marker8` is the
+  // family's 8-bit marker (or the value just below its 16-bit marker).
+  size_t read_length(uint8_t marker, uint8_t marker8)
+  {
+    switch (marker - marker8)
+    {
+    case 0:
+      return m_buffer.read<uint8_t>();
+    case 1:
+      return m_buffer.read<uint16_t>();
+    default:
+      return m_buffer.read<uint32_t>();
+    }
+  }
+
+  static bool is_negative_integer(uint8_t marker)
+  {
+    return marker >= 0xe0 || (marker >= msgpack_detail::int8 &&
+                              marker <= msgpack_detail::int64);
+  }
+
+  int64_t read_signed(uint8_t marker)
+  {
+    if (marker >= 0xe0)
+      return static_cast<int8_t>(marker);
+    switch (marker)
+    {
+    case msgpack_detail::int8:
+      return m_buffer.read<int8_t>();
+    case msgpack_detail::int16:
+      return m_buffer.read<int16_t>();
+    case msgpack_detail::int32:
+      return m_buffer.read<int32_t>();
+    default:
+      return m_buffer.read<int64_t>();
+    }
+  }
+
+  uint64_t read_unsigned(uint8_t marker)
+  {
+    if (marker < 0x80)
+      return marker;
+    switch (marker)
+    {
+    case msgpack_detail::uint8:
+      return m_buffer.read<uint8_t>();
+    case msgpack_detail::uint16:
+      return m_buffer.read<uint16_t>();
+    case msgpack_detail::uint32:
+      return m_buffer.read<uint32_t>();
+    case msgpack_detail::uint64:
+      return m_buffer.read<uint64_t>();
+    default:
+      throw std::runtime_error("MessagePack type mismatch");
+    }
+  }
+
+  std::string_view read_str()
+  {
+    const uint8_t marker = m_buffer.read<uint8_t>();
+    size_t length;
+    if ((marker & 0xE0) == msgpack_detail::fixstr)
+    {
+      length = marker & 0x1F;
+    }
+    else if (marker >= msgpack_detail::str8 && marker <= msgpack_detail::str32)
+    {
+      length = read_length(marker, msgpack_detail::str8);
+    }
+    else
+    {
+      throw std::runtime_error("MessagePack type mismatch");
+    }
+    if (length > remaining())
+    {
+      throw std::runtime_error("String extends beyond buffer");
+    }
+    return std::string_view(
+        reinterpret_cast<const char *>(m_buffer.read_bytes(length)), length);
+  }
+
+  template <typename Map> MsgPackDeserializer &read_entries(Map &map)
+  {
+    const size_t count = read_map_header();
+    for (size_t i = 0; i < count; ++i)
+    {
+      typename Map::key_type key;
+      typename Map::mapped_type value;
+      *this >> key >> value;
+      map.emplace(std::move(key), std::move(value));
+    }
+    return *this;
+  }
+};
+
+}
@@ -0,0 +1,422 @@
+#pragma once
+
+#include "binary_serializer.hpp"
+
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BINARY_SERIALIZER_MMAP 1
+#endif
+
+namespace binary_serializer
+{
+
+// NumPy .npy files: a magic string, a version, a little-endian header
+// length and a Python dict literal describing dtype, memory order and
+// shape, padded so the raw array data starts on a 64-byte boundary.
+struct npy_header
+{
+  char kind = 'f';
+  size_t item_size = 0;
+  endianness byte_order = endianness::little;
+  bool fortran_order = false;
+  std::vector<size_t> shape;
+  size_t data_offset = 0;
+
+  size_t count() const
+  {
+    size_t total = 1;
+    for (size_t dim : shape)
+      total *= dim;
+    return total;
+  }
+};
+
+namespace npy_detail
+{
+
+constexpr uint8_t magic[] = {0x93, 'N', 'U', 'M', 'P', 'Y'};
+
+template <typename T> constexpr char kind_of()
+{
+  static_assert(std::is_arithmetic_v<T>, "Type must be arithmetic");
+  if constexpr (std::is_same_v<T, bool>)
+    return 'b';
+  else if constexpr (std::is_floating_point_v<T>)
+    return 'f';
+  else if constexpr (std::is_signed_v<T>)
+    return 'i';
+  else
+    return 'u';
+}
+
+inline std::string descr(char kind, size_t item_size, endianness order)
+{
+  const char prefix =
+      item_size == 1 ? '|' : (order == endianness::big ? '>' : '<');
+  return std::string(1, prefix) + kind + std::to_string(item_size);
+}
+
+// Decimal number from header text; malformed or oversized values are
+// reported like every other header error.
+inline size_t parse_size(std::string_view digits)
+{
+  if (digits.empty())
+  {
+    throw std::runtime_error("Malformed npy header number");
+  }
+  size_t value = 0;
+  for (char c : digits)
+  {
+    if (c < '0' || c > '9')
+      throw std::runtime_error("Malformed npy header number");
+    const size_t digit = static_cast<size_t>(c - '0');
+    if (value > (SIZE_MAX - digit) / 10)
+      throw std::runtime_error("npy header number overflows");
+    value = value * 10 + digit;
+  }
+  return value;
+}
+
+// Value of `'key': ` in the header dict, up to the next top-level comma.
+inline std::string_view dict_value(std::string_view header,
+                                   std::string_view key)
+{
+  const std::string quoted = "'" + std::string(key) + "'";
+  size_t pos = header.find(quoted);
+  if (pos == std::string_view::npos)
+  {
+    throw std::runtime_error("npy header is missing a field");
+  }
+  pos = header.find(':', pos + quoted.size());
+  if (pos == std::string_view::npos)
+  {
+    throw std::runtime_error("Malformed npy header");
+  }
+  pos = header.find_first_not_of(' ', pos + 1);
+  if (pos == std::string_view::npos)
+  {
+    throw std::runtime_error("Malformed npy header");
+  }
+  size_t end = header[pos] == '(' ? header.find(')', pos)
+                                  : header.find_first_of(",}", pos);
+  if (end == std::string_view::npos)
+  {
+    throw std::runtime_error("Malformed npy header");
+  }
+  if (header[pos] == '(')
+    ++end;
+  return header.substr(pos, end - pos);
+}
+
+inline npy_header parse_dict(std::string_view dict)
+{
+  npy_header header;
+
+  std::string_view type = dict_value(dict, "descr");
+  if (type.size() < 5 || (type.front() != '\'' && type.front() != '"'))
+  {
+    throw std::runtime_error("Malformed npy dtype");
+  }
+  type = type.substr(1, type.size() - 2);
+  if (type[0] == '>')
+    header.byte_order = endianness::big;
+  else if (type[0] == '<' || type[0] == '|' || type[0] == '=')
+    header.byte_order = type[0] == '=' ? get_system_endianness()
+                                       : endianness::little;
+  else
+    throw std::runtime_error("Unsupported npy dtype");
+  header.kind = type[1];
+  header.item_size = parse_size(type.substr(2));
+  if (header.item_size == 0)
+  {
+    throw std::runtime_error("Malformed npy dtype");
+  }
+
+  header.fortran_order = dict_value(dict, "fortran_order") == "True";
+
+  std::string_view shape = dict_value(dict, "shape");
+  for (size_t i = 1; i < shape.size();)
+  {
+    const size_t digit = shape.find_first_of("0123456789", i);
+    if (digit == std::string_view::npos)
+      break;
+    const size_t end = shape.find_first_not_of("0123456789", digit);
+    header.shape.push_back(parse_size(shape.substr(digit, end - digit)));
+    i = end;
+  }
+  return header;
+}
+
+} // namespace npy_detail
+
+// Parses the preamble and header of an in-memory .npy image.
+inline npy_header read_npy_header(byte_view bytes)
+{
+  Buffer in(bytes, endianness::little);
+  if (bytes.size < sizeof(npy_detail::magic) + 2 ||
+      std::memcmp(in.read_bytes(sizeof(npy_detail::magic)), npy_detail::magic,
+                  sizeof(npy_detail::magic)) != 0)
+  {
+    throw std::runtime_error("Not an npy file");
+  }
+  const auto major = in.read<uint8_t>();
+  in.read<uint8_t>();
+  size_t length;
+  if (major == 1)
+    length = in.read<uint16_t>();
+  else if (major == 2 || major == 3)
+    length = in.read<uint32_t>();
+  else
+    throw std::runtime_error("Unsupported npy version");
+
+  const auto *dict = reinterpret_cast<const char *>(in.read_bytes(length));
+  npy_header header = npy_detail::parse_dict(std::string_view(dict, length));
+  header.data_offset = in.position();
+
+  size_t total = header.item_size;
+  for (size_t dim : header.shape)
+  {
+    if (dim != 0 && total > SIZE_MAX / dim)
+      throw std::runtime_error("npy array size overflows");
+    total *= dim;
+  }
+  if (total > bytes.size - header.data_offset)
+  {
+    throw std::runtime_error("npy data extends beyond file");
+  }
+  return header;
+}
+
+// Encodes `count` values laid out in C order with the given shape.
+template <typename T>
+std::vector<uint8_t> to_npy(const T *values, const std::vector<size_t> &shape,
+                            endianness endian = endianness::native)
+{
+  if (endian == endianness::native)
+    endian = get_system_endianness();
+
+  std::string shape_text = "(";
+  size_t count = 1;
+  for (size_t dim : shape)
+  {
+    shape_text += std::to_string(dim) + ", ";
+    count *= dim;
+  }
+  if (shape.size() > 1)
+    shape_text.resize(shape_text.size() - 2);
+  else if (shape.size() == 1)
+    shape_text.pop_back();
+  shape_text += ")";
+
+  std::string dict = "{'descr': '" +
+                     npy_detail::descr(npy_detail::kind_of<T>(), sizeof(T),
+                                       endian) +
+                     "', 'fortran_order': False, 'shape': " + shape_text +
+                     ", }";
+
+  // Pad with spaces and a newline so the data is 64-byte aligned; fall
+  // back to version 2.0 when the header outgrows a uint16 length.
+  const bool wide = dict.size() + 1 > 65535 - 64;
+  const size_t preamble = sizeof(npy_detail::magic) + 2 + (wide ? 4 : 2);
+  const size_t padded = (preamble + dict.size() + 1 + 63) / 64 * 64;
+  dict.append(padded - preamble - dict.size() - 1, ' ');
+  dict.push_back('\n');
+
+  Buffer out(endianness::little);
+  out.reserve(padded + count * sizeof(T));
+  out.write_bytes(npy_detail::magic, sizeof(npy_detail::magic));
+  out.write<uint8_t>(wide ? 2 : 1);
+  out.write<uint8_t>(0);
+  if (wide)
+    out.write<uint32_t>(static_cast<uint32_t>(dict.size()));
+  else
+    out.write<uint16_t>(static_cast<uint16_t>(dict.size()));
+  out.write_bytes(reinterpret_cast<const uint8_t *>(dict.data()), dict.size());
+
+  out.set_endianness(endian);
+  out.write_bulk(values, count);
+  return out.vector();
+}
+
+template <typename T>
+std::vector<uint8_t> to_npy(const std::vector<T> &values,
+                            endianness endian = endianness::native)
+{
+  return to_npy(values.data(), {values.size()}, endian);
+}
+
+// Decodes the array data as T, converting byte order when needed. The
+// dtype must match T exactly. Fortran-order (column-major) arrays are
+// rejected unless `allow_fortran_order` is set, in which case the values
+// are returned in file order and the caller must index them column-major.
+template <typename T>
+std::vector<T> from_npy(byte_view bytes, std::vector<size_t> *shape = nullptr,
+                        bool allow_fortran_order = false)
+{
+  const npy_header header = read_npy_header(bytes);
+  if (header.kind != npy_detail::kind_of<T>() || header.item_size != sizeof(T))
+  {
+    throw std::runtime_error("npy dtype does not match requested type");
+  }
+  if (header.fortran_order && !allow_fortran_order)
+  {
+    throw std::runtime_error("npy array is in Fortran order");
+  }
+
+  Buffer in(bytes, header.byte_order);
+  in.set_position(header.data_offset);
+  std::vector<T> values(header.count());
+  in.read_bulk(values.data(), values.size());
+  if (shape)
+    *shape = header.shape;
+  return values;
+}
+
+inline void write_npy_file(const std::string &path,
+                           const std::vector<uint8_t> &image)
+{
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char *>(image.data()),
+             static_cast<std::streamsize>(image.size()));
+  if (!file)
+  {
+    throw std::runtime_error("Failed to write npy file");
+  }
+}
+
+// Read-only view of an .npy file. The file is memory-mapped where the
+// platform supports it, so opening a multi-gigabyte array only parses the
+// header; pages are read on first access. Elsewhere it is read into memory.
+class MappedNpy
+{
+private:
+  npy_header m_header;
+  const uint8_t *m_data = nullptr;
+  size_t m_size = 0;
+  std::vector<uint8_t> m_fallback;
+  bool m_allow_fortran_order;
+
+public:
+  // Fortran-order files are rejected unless `allow_fortran_order` is set;
+  // header().fortran_order then tells the caller how to index the data.
+  explicit MappedNpy(const std::string &path, bool allow_fortran_order = false)
+      : m_allow_fortran_order(allow_fortran_order)
+  {
+#ifdef BINARY_SERIALIZER_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+      throw std::runtime_error("Failed to open npy file");
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0)
+    {
+      ::close(fd);
+      throw std::runtime_error("Failed to stat npy file");
+    }
+    m_size = static_cast<size_t>(info.st_size);
+    void *mapped = m_size == 0 ? MAP_FAILED
+                               : ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED,
+                                        fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+      throw std::runtime_error("Failed to map npy file");
+    }
+    m_data = static_cast<const uint8_t *>(mapped);
+#else
+    std::ifstream file(path, std::ios::binary);
+    m_fallback.assign(std::istreambuf_iterator<char>(file),
+                      std::istreambuf_iterator<char>());
+    if (!file && !file.eof())
+    {
+      throw std::runtime_error("Failed to read npy file");
+    }
+    m_data = m_fallback.data();
+    m_size = m_fallback.size();
+#endif
+    try
+    {
+      m_header = read_npy_header(byte_view(m_data, m_size));
+      if (m_header.fortran_order && !allow_fortran_order)
+      {
+        throw std::runtime_error("npy array is in Fortran order");
+      }
+    }
+    catch (...)
+    {
+      unmap();
+      throw;
+    }
+  }
+
+  ~MappedNpy()
+  {
+    unmap();
+  }
+
+  MappedNpy(const MappedNpy &) = delete;
+  MappedNpy &operator=(const MappedNpy &) = delete;
+
+  const npy_header &header() const
+  {
+    return m_header;
+  }
+  const std::vector<size_t> &shape() const
+  {
+    return m_header.shape;
+  }
+  size_t count() const
+  {
+    return m_header.count();
+  }
+
+  // Raw array bytes in the file's byte order.
+  byte_view bytes() const
+  {
+    return byte_view(m_data + m_header.data_offset,
+                     m_header.count() * m_header.item_size);
+  }
+
+  // Zero-copy typed access; requires a matching dtype in native byte order.
+  template <typename T> const T *data() const
+  {
+    if (m_header.kind != npy_detail::kind_of<T>() ||
+        m_header.item_size != sizeof(T) ||
+        (sizeof(T) > 1 && m_header.byte_order != get_system_endianness()))
+    {
+      throw std::runtime_error("npy data is not a native array of this type");
+    }
+    if (reinterpret_cast<uintptr_t>(m_data + m_header.data_offset) %
+            alignof(T) !=
+        0)
+    {
+      throw std::runtime_error("npy data is misaligned");
+    }
+    return reinterpret_cast<const T *>(m_data + m_header.data_offset);
+  }
+
+  // Copying decode that also handles foreign byte order.
+  template <typename T> std::vector<T> to_vector() const
+  {
+    return from_npy<T>(byte_view(m_data, m_size), nullptr,
+                       m_allow_fortran_order);
+  }
+
+private:
+  void unmap()
+  {
+#ifdef BINARY_SERIALIZER_MMAP
+    if (m_data)
+      ::munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+    m_data = nullptr;
+  }
+};
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "schema.hpp"
+
+#include <initializer_list>
+
+namespace binary_serializer
+{
+
+// Decodes only the requested fields of a schema record. Every other field is
+// skipped by its fixed width or length prefix without being materialized,
+// and the deserializer is left at the start of the next record.
+class Projection
+{
+private:
+  static constexpr size_t not_selected = SIZE_MAX;
+
+  const Schema *m_schema;
+  std::vector<size_t> m_slots;
+  size_t m_count = 0;
+
+public:
+  Projection(const Schema &schema, std::initializer_list<std::string_view> names)
+      : Projection(schema, std::vector<std::string_view>(names))
+  {}
+
+  Projection(const Schema &schema, const std::vector<std::string_view> &names)
+      : m_schema(&schema), m_slots(schema.size(), not_selected)
+  {
+    for (std::string_view name : names)
+    {
+      const size_t index = schema.index_of(name);
+      if (m_slots[index] != not_selected)
+      {
+        throw std::invalid_argument("Field projected twice");
+      }
+      m_slots[index] = m_count++;
+    }
+  }
+
+  size_t size() const
+  {
+    return m_count;
+  }
+
+  // Calls `visitor(slot, in)` for each projected field in record order,
+  // where `slot` is the field's position in the requested name list. The
+  // visitor may read all or part of the field.
+  template <typename F> void read(Deserializer &in, F &&visitor) const
+  {
+    const Schema &schema = *m_schema;
+    for (size_t i = 0; i < schema.size(); ++i)
+    {
+      if (m_slots[i] == not_selected)
+      {
+        skip_field(in, schema[i]);
+        continue;
+      }
+
+      const size_t start = in.position();
+      skip_field(in, schema[i]);
+      const size_t end = in.position();
+      in.set_position(start);
+      visitor(m_slots[i], in);
+      in.set_position(end);
+    }
+  }
+
+  // Reads the projected fields into `values`, given in requested order.
+  // std::string_view targets avoid allocating for string fields.
+  template <typename... T> void read_values(Deserializer &in, T &...values) const
+  {
+    if (sizeof...(T) != m_count)
+    {
+      throw std::invalid_argument("Projection value count mismatch");
+    }
+    read(in, [&](size_t slot, Deserializer &field_in)
+         {
+           size_t index = 0;
+           ((index++ == slot ? (void)(field_in >> values) : (void)0), ...);
+         });
+  }
+};
+
+}
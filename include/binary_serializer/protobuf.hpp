@@ -0,0 +1,364 @@
+#pragma once
+
+#include "binary_serializer.hpp"
+
+namespace binary_serializer
+{
+
+// Protocol Buffers wire format. Messages are described by the sequence of
+// write_* calls on a ProtoWriter and read back field by field with a
+// ProtoReader; field numbers and scalar types follow the .proto definition.
+enum class wire_type : uint8_t
+{
+  varint = 0,
+  fixed64 = 1,
+  length_delimited = 2,
+  fixed32 = 5
+};
+
+namespace proto_detail
+{
+
+inline size_t varint_size(uint64_t value)
+{
+  size_t size = 1;
+  while (value >= 0x80)
+  {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+inline uint64_t zigzag(int64_t value)
+{
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value)
+{
+  return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+template <typename T> constexpr wire_type fixed_wire_type()
+{
+  static_assert(sizeof(T) == 4 || sizeof(T) == 8,
+                "Fixed fields must be 32 or 64 bits wide");
+  return sizeof(T) == 4 ? wire_type::fixed32 : wire_type::fixed64;
+}
+
+} // namespace proto_detail
+
+class ProtoWriter
+{
+private:
+  Buffer m_buffer;
+
+public:
+  ProtoWriter() : m_buffer(endianness::little)
+  {}
+
+  void write_tag(uint32_t field, wire_type type)
+  {
+    m_buffer.write_varint((static_cast<uint64_t>(field) << 3) |
+                          static_cast<uint64_t>(type));
+  }
+
+  // uint32, uint64, enum
+  ProtoWriter &write_uint(uint32_t field, uint64_t value)
+  {
+    write_tag(field, wire_type::varint);
+    m_buffer.write_varint(value);
+    return *this;
+  }
+
+  // int32, int64: negative values are sign extended to ten bytes.
+  ProtoWriter &write_int(uint32_t field, int64_t value)
+  {
+    return write_uint(field, static_cast<uint64_t>(value));
+  }
+
+  // sint32, sint64
+  ProtoWriter &write_sint(uint32_t field, int64_t value)
+  {
+    return write_uint(field, proto_detail::zigzag(value));
+  }
+
+  ProtoWriter &write_bool(uint32_t field, bool value)
+  {
+    return write_uint(field, value ? 1 : 0);
+  }
+
+  // fixed32, fixed64, sfixed32, sfixed64, float, double
+  template <typename T> ProtoWriter &write_fixed(uint32_t field, T value)
+  {
+    write_tag(field, proto_detail::fixed_wire_type<T>());
+    m_buffer.write(value);
+    return *this;
+  }
+
+  ProtoWriter &write_bytes(uint32_t field, const uint8_t *bytes, size_t size)
+  {
+    write_tag(field, wire_type::length_delimited);
+    m_buffer.write_varint(size);
+    m_buffer.write_bytes(bytes, size);
+    return *this;
+  }
+
+  ProtoWriter &write_string(uint32_t field, std::string_view str)
+  {
+    return write_bytes(field, reinterpret_cast<const uint8_t *>(str.data()),
+                       str.size());
+  }
+
+  // Packed repeated fixed-width field, written with a single bulk copy.
+  template <typename T>
+  ProtoWriter &write_packed_fixed(uint32_t field, const std::vector<T> &values)
+  {
+    proto_detail::fixed_wire_type<T>();
+    if (values.empty())
+      return *this;
+    write_tag(field, wire_type::length_delimited);
+    m_buffer.write_varint(values.size() * sizeof(T));
+    m_buffer.write_bulk(values.data(), values.size());
+    return *this;
+  }
+
+  template <typename T>
+  ProtoWriter &write_packed_varint(uint32_t field, const std::vector<T> &values)
+  {
+    static_assert(std::is_integral_v<T>, "Type must be integral");
+    return write_packed(field, values, [](T value)
+                        { return static_cast<uint64_t>(
+                              static_cast<int64_t>(value)); });
+  }
+
+  template <typename T>
+  ProtoWriter &write_packed_sint(uint32_t field, const std::vector<T> &values)
+  {
+    static_assert(std::is_signed_v<T>, "Type must be signed");
+    return write_packed(field, values, [](T value)
+                        { return proto_detail::zigzag(value); });
+  }
+
+  // Nested message: `fn(ProtoWriter &)` writes the fields of the child.
+  template <typename F> ProtoWriter &write_message(uint32_t field, F &&fn)
+  {
+    ProtoWriter child;
+    fn(child);
+    const Buffer &encoded = child.get_buffer();
+    return write_bytes(field, encoded.data(), encoded.size());
+  }
+
+  const Buffer &get_buffer() const
+  {
+    return m_buffer;
+  }
+  std::vector<uint8_t> get_data() const
+  {
+    return m_buffer.vector();
+  }
+  void clear()
+  {
+    m_buffer.clear();
+  }
+
+private:
+  template <typename T, typename Encode>
+  ProtoWriter &write_packed(uint32_t field, const std::vector<T> &values,
+                            Encode encode)
+  {
+    if (values.empty())
+      return *this;
+
+    size_t size = 0;
+    for (T value : values)
+    {
+      size += proto_detail::varint_size(encode(value));
+    }
+    write_tag(field, wire_type::length_delimited);
+    m_buffer.write_varint(size);
+    m_buffer.reserve(m_buffer.size() + size);
+    for (T value : values)
+    {
+      m_buffer.write_varint(encode(value));
+    }
+    return *this;
+  }
+};
+
+class ProtoReader
+{
+private:
+  Buffer m_buffer;
+  uint32_t m_field = 0;
+  wire_type m_wire_type = wire_type::varint;
+
+public:
+  // Reads in place; `data` must outlive the reader and any views it returns.
+  explicit ProtoReader(byte_view data) : m_buffer(data, endianness::little)
+  {}
+
+  // Advances to the next field; returns false at the end of the message.
+  bool next()
+  {
+    if (m_buffer.position() >= m_buffer.size())
+    {
+      return false;
+    }
+
+    const uint64_t tag = m_buffer.read_varint();
+    const auto type = static_cast<uint8_t>(tag & 0x7);
+    if (type != 0 && type != 1 && type != 2 && type != 5)
+    {
+      throw std::runtime_error("Unsupported protobuf wire type");
+    }
+    if ((tag >> 3) == 0 || (tag >> 3) > 0x1FFFFFFF)
+    {
+      throw std::runtime_error("Invalid protobuf field number");
+    }
+    m_field = static_cast<uint32_t>(tag >> 3);
+    m_wire_type = static_cast<wire_type>(type);
+    return true;
+  }
+
+  uint32_t field() const
+  {
+    return m_field;
+  }
+  wire_type type() const
+  {
+    return m_wire_type;
+  }
+
+  uint64_t read_uint()
+  {
+    expect(wire_type::varint);
+    return m_buffer.read_varint();
+  }
+
+  int64_t read_int()
+  {
+    return static_cast<int64_t>(read_uint());
+  }
+
+  int64_t read_sint()
+  {
+    return proto_detail::unzigzag(read_uint());
+  }
+
+  bool read_bool()
+  {
+    return read_uint() != 0;
+  }
+
+  template <typename T> T read_fixed()
+  {
+    expect(proto_detail::fixed_wire_type<T>());
+    return m_buffer.read<T>();
+  }
+
+  byte_view read_bytes()
+  {
+    expect(wire_type::length_delimited);
+    const uint64_t size = m_buffer.read_varint();
+    if (size > m_buffer.size() - m_buffer.position())
+    {
+      throw std::runtime_error("Protobuf field extends beyond buffer");
+    }
+    return byte_view(m_buffer.read_bytes(static_cast<size_t>(size)),
+                     static_cast<size_t>(size));
+  }
+
+  std::string_view read_string()
+  {
+    const byte_view bytes = read_bytes();
+    return std::string_view(reinterpret_cast<const char *>(bytes.data),
+                            bytes.size);
+  }
+
+  ProtoReader read_message()
+  {
+    return ProtoReader(read_bytes());
+  }
+
+  // Repeated fields accept both packed and unpacked encodings, as protobuf
+  // parsers are required to.
+  template <typename T> void read_packed_fixed(std::vector<T> &values)
+  {
+    if (m_wire_type != wire_type::length_delimited)
+    {
+      values.push_back(read_fixed<T>());
+      return;
+    }
+
+    const byte_view bytes = read_bytes();
+    if (bytes.size % sizeof(T) != 0)
+    {
+      throw std::runtime_error("Packed field size mismatch");
+    }
+    const size_t start = values.size();
+    values.resize(start + bytes.size / sizeof(T));
+    Buffer packed(bytes, endianness::little);
+    packed.read_bulk(values.data() + start, bytes.size / sizeof(T));
+  }
+
+  template <typename T> void read_packed_varint(std::vector<T> &values)
+  {
+    read_packed(values, [](uint64_t raw) { return static_cast<T>(raw); });
+  }
+
+  template <typename T> void read_packed_sint(std::vector<T> &values)
+  {
+    read_packed(values, [](uint64_t raw)
+                { return static_cast<T>(proto_detail::unzigzag(raw)); });
+  }
+
+  // Skips the current field, e.g. one unknown to this reader.
+  void skip()
+  {
+    switch (m_wire_type)
+    {
+    case wire_type::varint:
+      m_buffer.read_varint();
+      break;
+    case wire_type::fixed64:
+      m_buffer.read_bytes(8);
+      break;
+    case wire_type::length_delimited:
+      read_bytes();
+      break;
+    case wire_type::fixed32:
+      m_buffer.read_bytes(4);
+      break;
+    }
+  }
+
+private:
+  void expect(wire_type type) const
+  {
+    if (m_wire_type != type)
+    {
+      throw std::runtime_error("Protobuf wire type mismatch");
+    }
+  }
+
+  template <typename T, typename Decode>
+  void read_packed(std::vector<T> &values, Decode decode)
+  {
+    if (m_wire_type == wire_type::varint)
+    {
+      values.push_back(decode(m_buffer.read_varint()));
+      return;
+    }
+
+    Buffer packed(read_bytes(), endianness::little);
+    while (packed.position() < packed.size())
+    {
+      values.push_back(decode(packed.read_varint()));
+    }
+  }
+};
+
+}
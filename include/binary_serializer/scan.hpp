@@ -0,0 +1,359 @@
+#pragma once
+
+#include "schema.hpp"
+
+namespace binary_serializer
+{
+
+enum class compare_op
+{
+  equal,
+  not_equal,
+  less,
+  less_equal,
+  greater,
+  greater_equal
+};
+
+// Filters a log of back-to-back schema records by evaluating predicates on
+// the encoded bytes; only matching records are handed to the caller. When
+// every field is fixed width the records have a constant stride and each
+// predicate is applied to a batch of records in one tight loop. Otherwise
+// fields are located per record by skipping over length prefixes.
+class RecordScanner
+{
+private:
+  struct predicate
+  {
+    size_t field;
+    compare_op op;
+    int64_t signed_operand = 0;
+    uint64_t unsigned_operand = 0;
+    double float_operand = 0.0;
+    bool float_compare = false;
+    std::string string_operand;
+  };
+
+  static constexpr size_t batch_size = 256;
+
+  const Schema *m_schema;
+  endianness m_endianness;
+  std::vector<predicate> m_predicates;
+  std::vector<size_t> m_offsets;
+  size_t m_stride = 0;
+
+public:
+  explicit RecordScanner(const Schema &schema,
+                         endianness endian = endianness::native)
+      : m_schema(&schema), m_endianness(endian)
+  {
+    if (schema.size() == 0)
+    {
+      throw std::invalid_argument("Cannot scan records of an empty schema");
+    }
+    if (m_endianness == endianness::native)
+    {
+      m_endianness = get_system_endianness();
+    }
+    for (const field &f : schema.fields())
+    {
+      const size_t width = fixed_width(f.type);
+      if (width == 0)
+      {
+        m_stride = 0;
+        m_offsets.clear();
+        break;
+      }
+      m_offsets.push_back(m_stride);
+      m_stride += width;
+    }
+  }
+
+  template <typename T>
+  RecordScanner &where(std::string_view name, compare_op op, T value)
+  {
+    predicate p;
+    p.field = m_schema->index_of(name);
+    p.op = op;
+    const field_type type = (*m_schema)[p.field].type;
+
+    if constexpr (std::is_arithmetic_v<T>)
+    {
+      if (type == field_type::string || type == field_type::array)
+      {
+        throw std::invalid_argument("Numeric predicate on non-scalar field");
+      }
+      if (is_float(type))
+      {
+        p.float_operand = static_cast<double>(value);
+      }
+      else if (std::is_floating_point_v<T> && !exact_integer(type, value))
+      {
+        // A fractional or out-of-range operand on an integer field is
+        // compared in double so `x < 2.5` still matches 2.
+        p.float_operand = static_cast<double>(value);
+        p.float_compare = true;
+      }
+      else if (is_signed(type))
+      {
+        if constexpr (std::is_unsigned_v<T>)
+        {
+          if (static_cast<uint64_t>(value) > INT64_MAX)
+            throw std::invalid_argument("Predicate operand out of range");
+        }
+        p.signed_operand = static_cast<int64_t>(value);
+      }
+      else
+      {
+        if constexpr (std::is_signed_v<T>)
+        {
+          if (value < 0)
+            throw std::invalid_argument("Predicate operand out of range");
+        }
+        p.unsigned_operand = static_cast<uint64_t>(value);
+      }
+    }
+    else
+    {
+      if (type != field_type::string ||
+          (op != compare_op::equal && op != compare_op::not_equal))
+      {
+        throw std::invalid_argument(
+            "String predicates support only (in)equality on string fields");
+      }
+      p.string_operand = std::string(value);
+    }
+    m_predicates.push_back(std::move(p));
+    return *this;
+  }
+
+  template <typename T>
+  RecordScanner &where_between(std::string_view name, T low, T high)
+  {
+    where(name, compare_op::greater_equal, low);
+    return where(name, compare_op::less_equal, high);
+  }
+
+  // Calls `on_match(Deserializer &)` with a reader over each matching
+  // record's bytes; returns the number of matches.
+  template <typename F> size_t scan(byte_view log, F &&on_match) const
+  {
+    return m_stride != 0 ? scan_fixed(log, on_match)
+                         : scan_variable(log, on_match);
+  }
+
+private:
+  static bool is_float(field_type type)
+  {
+    return type == field_type::float32 || type == field_type::float64;
+  }
+
+  static bool is_signed(field_type type)
+  {
+    return type == field_type::int8 || type == field_type::int16 ||
+           type == field_type::int32 || type == field_type::int64;
+  }
+
+  // True when `value` converts exactly to the integer operand domain of
+  // `type` (int64 for signed fields, uint64 for unsigned).
+  template <typename T> static bool exact_integer(field_type type, T value)
+  {
+    if constexpr (std::is_floating_point_v<T>)
+    {
+      const double v = static_cast<double>(value);
+      if (std::trunc(v) != v)
+        return false;
+      return is_signed(type) ? v >= -9223372036854775808.0 &&
+                                   v < 9223372036854775808.0
+                             : v >= 0.0 && v < 18446744073709551616.0;
+    }
+    else
+    {
+      return true;
+    }
+  }
+
+  template <typename V> static bool compare(compare_op op, V a, V b)
+  {
+    switch (op)
+    {
+    case compare_op::equal:
+      return a == b;
+    case compare_op::not_equal:
+      return a != b;
+    case compare_op::less:
+      return a < b;
+    case compare_op::less_equal:
+      return a <= b;
+    case compare_op::greater:
+      return a > b;
+    case compare_op::greater_equal:
+      return a >= b;
+    }
+    return false;
+  }
+
+  // Widens the field value to the operand's domain before comparing.
+  template <typename T>
+  static bool test_value(const predicate &p, T value)
+  {
+    if (p.float_compare)
+      return compare<double>(p.op, static_cast<double>(value), p.float_operand);
+    if constexpr (std::is_floating_point_v<T>)
+      return compare<double>(p.op, value, p.float_operand);
+    else if constexpr (std::is_signed_v<T>)
+      return compare<int64_t>(p.op, value, p.signed_operand);
+    else
+      return compare<uint64_t>(p.op, value, p.unsigned_operand);
+  }
+
+  template <typename T, typename Cmp>
+  static void filter_batch(const uint8_t *base, size_t stride, size_t count,
+                           bool swap, Cmp cmp, uint8_t *mask)
+  {
+    for (size_t r = 0; r < count; ++r)
+    {
+      mask[r] &= cmp(load_value<T>(base + r * stride, swap)) ? 1 : 0;
+    }
+  }
+
+  // The operator is resolved once per batch so the per-record loop is a
+  // plain load-compare-and.
+  template <typename T>
+  void filter_batch(const predicate &p, const uint8_t *base, size_t count,
+                    bool swap, uint8_t *mask) const
+  {
+    if (p.float_compare)
+    {
+      return filter_batch<T, double>(p.op, p.float_operand, base, count, swap,
+                                     mask);
+    }
+    if constexpr (std::is_floating_point_v<T>)
+      filter_batch<T, double>(p.op, p.float_operand, base, count, swap, mask);
+    else if constexpr (std::is_signed_v<T>)
+      filter_batch<T, int64_t>(p.op, p.signed_operand, base, count, swap, mask);
+    else
+      filter_batch<T, uint64_t>(p.op, p.unsigned_operand, base, count, swap,
+                                mask);
+  }
+
+  template <typename T, typename V>
+  void filter_batch(compare_op op, V operand, const uint8_t *base,
+                    size_t count, bool swap, uint8_t *mask) const
+  {
+    switch (op)
+    {
+    case compare_op::equal:
+      return filter_batch<T>(base, m_stride, count, swap,
+                             [=](T v) { return V(v) == operand; }, mask);
+    case compare_op::not_equal:
+      return filter_batch<T>(base, m_stride, count, swap,
+                             [=](T v) { return V(v) != operand; }, mask);
+    case compare_op::less:
+      return filter_batch<T>(base, m_stride, count, swap,
+                             [=](T v) { return V(v) < operand; }, mask);
+    case compare_op::less_equal:
+      return filter_batch<T>(base, m_stride, count, swap,
+                             [=](T v) { return V(v) <= operand; }, mask);
+    case compare_op::greater:
+      return filter_batch<T>(base, m_stride, count, swap,
+                             [=](T v) { return V(v) > operand; }, mask);
+    case compare_op::greater_equal:
+      return filter_batch<T>(base, m_stride, count, swap,
+                             [=](T v) { return V(v) >= operand; }, mask);
+    }
+  }
+
+  template <typename F> size_t scan_fixed(byte_view log, F &on_match) const
+  {
+    if (log.size % m_stride != 0)
+    {
+      throw std::runtime_error("Record log is not a whole number of records");
+    }
+
+    const bool swap = m_endianness != get_system_endianness();
+    const size_t records = log.size / m_stride;
+    uint8_t mask[batch_size];
+    size_t matches = 0;
+    for (size_t first = 0; first < records; first += batch_size)
+    {
+      const size_t count = std::min(batch_size, records - first);
+      const uint8_t *batch = log.data + first * m_stride;
+      std::memset(mask, 1, count);
+      for (const predicate &p : m_predicates)
+      {
+        const uint8_t *column = batch + m_offsets[p.field];
+        visit_scalar((*m_schema)[p.field].type, [&](auto tag)
+                     {
+                       using T = typename decltype(tag)::type;
+                       filter_batch<T>(p, column, count, swap, mask);
+                     });
+      }
+      for (size_t r = 0; r < count; ++r)
+      {
+        if (!mask[r])
+          continue;
+        ++matches;
+        Deserializer record(byte_view(batch + r * m_stride, m_stride),
+                            m_endianness);
+        on_match(record);
+      }
+    }
+    return matches;
+  }
+
+  template <typename F> size_t scan_variable(byte_view log, F &on_match) const
+  {
+    const Schema &schema = *m_schema;
+    Deserializer in(log, m_endianness);
+    size_t matches = 0;
+    while (in.has_more())
+    {
+      const size_t start = in.position();
+      bool matched = true;
+      for (size_t i = 0; i < schema.size(); ++i)
+      {
+        const size_t field_start = in.position();
+        for (const predicate &p : m_predicates)
+        {
+          if (!matched)
+            break;
+          if (p.field != i)
+            continue;
+          matched = test_field(p, schema[i], in);
+          in.set_position(field_start);
+        }
+        skip_field(in, schema[i]);
+      }
+
+      if (matched)
+      {
+        ++matches;
+        Deserializer record(
+            byte_view(log.data + start, in.position() - start), m_endianness);
+        on_match(record);
+      }
+    }
+    return matches;
+  }
+
+  static bool test_field(const predicate &p, const field &f, Deserializer &in)
+  {
+    if (f.type == field_type::string)
+    {
+      std::string_view value;
+      in >> value;
+      return (value == p.string_operand) == (p.op == compare_op::equal);
+    }
+    bool result = false;
+    visit_scalar(f.type, [&](auto tag)
+                 {
+                   typename decltype(tag)::type value;
+                   in >> value;
+                   result = test_value(p, value);
+                 });
+    return result;
+  }
+};
+
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "binary_serializer.hpp"
+
+namespace binary_serializer
+{
+
+// Runtime description of a flat record written field by field with
+// Serializer: scalars, strings and arrays of either (a uint32 count followed
+// by the elements, as std::vector is encoded).
+enum class field_type : uint8_t
+{
+  boolean,
+  int8,
+  uint8,
+  int16,
+  uint16,
+  int32,
+  uint32,
+  int64,
+  uint64,
+  float32,
+  float64,
+  string,
+  array
+};
+
+struct field
+{
+  std::string name;
+  field_type type;
+  field_type element = field_type::boolean;
+};
+
+template <typename T> struct type_tag
+{
+  using type = T;
+};
+
+// Calls `fn(type_tag<T>{})` with the C++ type of an arithmetic field type.
+template <typename F> void visit_scalar(field_type type, F &&fn)
+{
+  switch (type)
+  {
+  case field_type::boolean:
+    return fn(type_tag<bool>{});
+  case field_type::int8:
+    return fn(type_tag<int8_t>{});
+  case field_type::uint8:
+    return fn(type_tag<uint8_t>{});
+  case field_type::int16:
+    return fn(type_tag<int16_t>{});
+  case field_type::uint16:
+    return fn(type_tag<uint16_t>{});
+  case field_type::int32:
+    return fn(type_tag<int32_t>{});
+  case field_type::uint32:
+    return fn(type_tag<uint32_t>{});
+  case field_type::int64:
+    return fn(type_tag<int64_t>{});
+  case field_type::uint64:
+    return fn(type_tag<uint64_t>{});
+  case field_type::float32:
+    return fn(type_tag<float>{});
+  case field_type::float64:
+    return fn(type_tag<double>{});
+  default:
+    throw std::invalid_argument("Field type is not a scalar");
+  }
+}
+
+// Encoded size of a scalar field type, or 0 for strings and arrays.
+inline size_t fixed_width(field_type type)
+{
+  if (type == field_type::string || type == field_type::array)
+  {
+    return 0;
+  }
+  size_t width = 0;
+  visit_scalar(type, [&](auto tag)
+               { width = sizeof(typename decltype(tag)::type); });
+  return width;
+}
+
+// Advances `in` past one encoded field without materializing it.
+inline void skip_field(Deserializer &in, const field &f)
+{
+  if (f.type == field_type::string)
+  {
+    in.skip<std::string>();
+  }
+  else if (f.type != field_type::array)
+  {
+    in.skip_bytes(fixed_width(f.type));
+  }
+  else if (f.element == field_type::string)
+  {
+    in.skip<std::vector<std::string>>();
+  }
+  else
+  {
+    uint32_t count;
+    in >> count;
+    const size_t width = fixed_width(f.element);
+    if (count > in.remaining() / width)
+    {
+      throw std::runtime_error("Array extends beyond buffer");
+    }
+    in.skip_bytes(count * width);
+  }
+}
+
+class Schema
+{
+private:
+  std::vector<field> m_fields;
+
+public:
+  Schema &add(std::string name, field_type type)
+  {
+    if (type == field_type::array)
+    {
+      throw std::invalid_argument("Use add_array for array fields");
+    }
+    m_fields.push_back(field{std::move(name), type});
+    return *this;
+  }
+
+  Schema &add_array(std::string name, field_type element)
+  {
+    if (element == field_type::array)
+    {
+      throw std::invalid_argument("Nested arrays are not supported");
+    }
+    m_fields.push_back(field{std::move(name), field_type::array, element});
+    return *this;
+  }
+
+  const std::vector<field> &fields() const
+  {
+    return m_fields;
+  }
+  const field &operator[](size_t index) const
+  {
+    return m_fields[index];
+  }
+  size_t size() const
+  {
+    return m_fields.size();
+  }
+
+  size_t index_of(std::string_view name) const
+  {
+    for (size_t i = 0; i < m_fields.size(); ++i)
+    {
+      if (m_fields[i].name == name)
+      {
+        return i;
+      }
+    }
+    throw std::out_of_range("Unknown schema field");
+  }
+};
+
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "binary_serializer.hpp"
+
+namespace binary_serializer
+{
+
+// Keeps an encoded message together with the byte span of every field so a
+// single field can be re-encoded and patched in place. Fixed-size fields are
+// overwritten; fields whose encoded size changes are spliced and the spans
+// after them are shifted.
+class TrackedSerializer
+{
+public:
+  struct byte_range
+  {
+    size_t offset;
+    size_t size;
+  };
+
+private:
+  Buffer m_buffer;
+  Serializer m_scratch;
+  std::vector<byte_range> m_fields;
+  std::vector<size_t> m_dirty;
+  std::vector<bool> m_is_dirty;
+  bool m_layout_changed = false;
+
+public:
+  explicit TrackedSerializer(endianness endian = endianness::native)
+      : m_buffer(endian), m_scratch(endian)
+  {}
+
+  template <typename T> size_t add(const T &value)
+  {
+    encode_scratch(value);
+    const auto &encoded = m_scratch.get_buffer();
+    m_fields.push_back(byte_range{m_buffer.size(), encoded.size()});
+    m_is_dirty.push_back(false);
+    m_buffer.write_bytes(encoded.data(), encoded.size());
+    return m_fields.size() - 1;
+  }
+
+  template <typename T> void set(size_t field, const T &value)
+  {
+    if (field >= m_fields.size())
+    {
+      throw std::out_of_range("Unknown tracked field");
+    }
+
+    encode_scratch(value);
+    const auto &encoded = m_scratch.get_buffer();
+    byte_range &range = m_fields[field];
+    if (encoded.size() == range.size &&
+        std::memcmp(m_buffer.data() + range.offset, encoded.data(),
+                    range.size) == 0)
+    {
+      return;
+    }
+
+    m_buffer.replace_bytes(range.offset, range.size, encoded.data(),
+                           encoded.size());
+    if (encoded.size() != range.size)
+    {
+      const auto delta = static_cast<std::ptrdiff_t>(encoded.size()) -
+                         static_cast<std::ptrdiff_t>(range.size);
+      for (size_t i = field + 1; i < m_fields.size(); ++i)
+      {
+        m_fields[i].offset =
+            static_cast<size_t>(static_cast<std::ptrdiff_t>(m_fields[i].offset) +
+                                delta);
+      }
+      range.size = encoded.size();
+      m_layout_changed = true;
+    }
+
+    if (!m_is_dirty[field])
+    {
+      m_is_dirty[field] = true;
+      m_dirty.push_back(field);
+    }
+  }
+
+  const std::vector<size_t> &dirty_fields() const
+  {
+    return m_dirty;
+  }
+
+  // Current byte spans of the fields modified since the last clear_dirty().
+  // When layout_changed() is true every byte after the first resized field
+  // has moved as well.
+  std::vector<byte_range> dirty_ranges() const
+  {
+    std::vector<byte_range> ranges;
+    ranges.reserve(m_dirty.size());
+    for (size_t field : m_dirty)
+    {
+      ranges.push_back(m_fields[field]);
+    }
+    return ranges;
+  }
+
+  bool layout_changed() const
+  {
+    return m_layout_changed;
+  }
+
+  void clear_dirty()
+  {
+    for (size_t field : m_dirty)
+    {
+      m_is_dirty[field] = false;
+    }
+    m_dirty.clear();
+    m_layout_changed = false;
+  }
+
+  byte_range field_range(size_t field) const
+  {
+    return m_fields.at(field);
+  }
+  size_t field_count() const
+  {
+    return m_fields.size();
+  }
+
+  const Buffer &get_buffer() const
+  {
+    return m_buffer;
+  }
+  std::vector<uint8_t> get_data() const
+  {
+    return m_buffer.vector();
+  }
+  void clear()
+  {
+    m_buffer.clear();
+    m_fields.clear();
+    m_dirty.clear();
+    m_is_dirty.clear();
+    m_layout_changed = false;
+  }
+
+private:
+  template <typename T> void encode_scratch(const T &value)
+  {
+    m_scratch.clear();
+    m_scratch << value;
+  }
+};
+
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include "binary_serializer.hpp"
+
+#include <typeinfo>
+
+namespace binary_serializer
+{
+
+// Polymorphic messages are written as a varint type ID followed by the
+// object body. Registered types provide
+//   void serialize(Serializer &) const;
+//   void deserialize(Deserializer &);
+// and must be default constructible. Decoding indexes a flat table of
+// factory functions by ID, so IDs are capped at TypeRegistry::max_id.
+namespace registry_detail
+{
+
+template <typename Base, typename Derived>
+void encode(Serializer &serializer, const Base &object)
+{
+  static_cast<const Derived &>(object).serialize(serializer);
+}
+
+template <typename Base, typename Derived>
+std::unique_ptr<Base> decode(Deserializer &deserializer)
+{
+  auto object = std::make_unique<Derived>();
+  object->deserialize(deserializer);
+  return object;
+}
+
+template <typename T, typename... Types> struct index_of;
+
+template <typename T, typename... Rest> struct index_of<T, T, Rest...>
+{
+  static constexpr uint32_t value = 0;
+};
+
+template <typename T, typename First, typename... Rest>
+struct index_of<T, First, Rest...>
+{
+  static constexpr uint32_t value = 1 + index_of<T, Rest...>::value;
+};
+
+} // namespace registry_detail
+
+template <typename Base> class TypeRegistry
+{
+public:
+  using encode_fn = void (*)(Serializer &, const Base &);
+  using decode_fn = std::unique_ptr<Base> (*)(Deserializer &);
+
+  static constexpr uint32_t max_id = 0xFFFF;
+
+private:
+  std::vector<encode_fn> m_encoders;
+  std::vector<decode_fn> m_decoders;
+  std::unordered_map<const std::type_info *, uint32_t> m_ids;
+
+public:
+  template <typename Derived> uint32_t add()
+  {
+    return add<Derived>(static_cast<uint32_t>(m_decoders.size()));
+  }
+
+  template <typename Derived> uint32_t add(uint32_t id)
+  {
+    static_assert(std::is_base_of_v<Base, Derived>,
+                  "Registered type must derive from the registry base");
+
+    if (id > max_id)
+    {
+      throw std::invalid_argument("Type ID exceeds registry limit");
+    }
+    if (id < m_decoders.size() && m_decoders[id] != nullptr)
+    {
+      throw std::invalid_argument("Type ID already registered");
+    }
+    if (find(typeid(Derived)) != nullptr)
+    {
+      throw std::invalid_argument("Type already registered");
+    }
+    if (id >= m_decoders.size())
+    {
+      m_encoders.resize(id + 1, nullptr);
+      m_decoders.resize(id + 1, nullptr);
+    }
+    m_encoders[id] = &registry_detail::encode<Base, Derived>;
+    m_decoders[id] = &registry_detail::decode<Base, Derived>;
+    m_ids[&typeid(Derived)] = id;
+    return id;
+  }
+
+  template <typename Derived> uint32_t id_of() const
+  {
+    return lookup(typeid(Derived));
+  }
+  uint32_t id_of(const Base &object) const
+  {
+    return lookup(typeid(object));
+  }
+
+  void write(Serializer &serializer, const Base &object) const
+  {
+    const uint32_t id = id_of(object);
+    serializer.write_varint(id);
+    m_encoders[id](serializer, object);
+  }
+
+  std::unique_ptr<Base> read(Deserializer &deserializer) const
+  {
+    uint64_t id;
+    deserializer.read_varint(id);
+    if (id >= m_decoders.size() || m_decoders[id] == nullptr)
+    {
+      throw std::runtime_error("Unknown type ID");
+    }
+    return m_decoders[id](deserializer);
+  }
+
+private:
+  const uint32_t *find(const std::type_info &type) const
+  {
+    auto it = m_ids.find(&type);
+    if (it != m_ids.end())
+    {
+      return &it->second;
+    }
+    // type_info objects are not guaranteed unique across shared libraries.
+    for (const auto &entry : m_ids)
+    {
+      if (*entry.first == type)
+      {
+        return &entry.second;
+      }
+    }
+    return nullptr;
+  }
+
+  uint32_t lookup(const std::type_info &type) const
+  {
+    const uint32_t *id = find(type);
+    if (id == nullptr)
+    {
+      throw std::runtime_error("Type not registered");
+    }
+    return *id;
+  }
+};
+
+// Compile-time variant: IDs are the positions in `Types` and the decoder
+// table is a constant array, so there is no registration at startup.
+template <typename Base, typename... Types> class StaticTypeRegistry
+{
+public:
+  using decode_fn = std::unique_ptr<Base> (*)(Deserializer &);
+
+  static constexpr uint32_t size = sizeof...(Types);
+
+  template <typename Derived> static constexpr uint32_t id_of()
+  {
+    return registry_detail::index_of<Derived, Types...>::value;
+  }
+
+  template <typename Derived>
+  static void write(Serializer &serializer, const Derived &object)
+  {
+    if constexpr (std::is_same_v<Derived, Base>)
+    {
+      write_dynamic(serializer, object);
+    }
+    else
+    {
+      serializer.write_varint(id_of<Derived>());
+      object.serialize(serializer);
+    }
+  }
+
+  static std::unique_ptr<Base> read(Deserializer &deserializer)
+  {
+    static constexpr decode_fn decoders[] = {
+        &registry_detail::decode<Base, Types>...};
+
+    uint64_t id;
+    deserializer.read_varint(id);
+    if (id >= size)
+    {
+      throw std::runtime_error("Unknown type ID");
+    }
+    return decoders[id](deserializer);
+  }
+
+private:
+  static void write_dynamic(Serializer &serializer, const Base &object)
+  {
+    const std::type_info &type = typeid(object);
+    const bool found = (try_write<Types>(serializer, object, type) || ...);
+    if (!found)
+    {
+      throw std::runtime_error("Type not registered");
+    }
+  }
+
+  template <typename Derived>
+  static bool try_write(Serializer &serializer, const Base &object,
+                        const std::type_info &type)
+  {
+    if (type != typeid(Derived))
+    {
+      return false;
+    }
+    serializer.write_varint(id_of<Derived>());
+    static_cast<const Derived &>(object).serialize(serializer);
+    return true;
+  }
+};
+
+}
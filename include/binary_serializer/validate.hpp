@@ -0,0 +1,327 @@
+#pragma once
+
+#include "schema.hpp"
+
+namespace binary_serializer
+{
+
+// Structural validation of untrusted input: walks the encoding of a type (or
+// a stream of schema records) checking every length prefix, count and
+// reference against the remaining bytes. Nothing is constructed, and only
+// shared_ptr type tags are stored; failures are reported as `false` rather
+// than exceptions, so rejecting malformed input costs about as much as
+// reading the prefixes.
+namespace validate_detail
+{
+
+class cursor
+{
+private:
+  const uint8_t *m_data;
+  size_t m_size;
+  size_t m_position = 0;
+  bool m_swap;
+
+public:
+  // Type of each shared object seen so far, so back-references can be
+  // checked; the only storage validation allocates.
+  std::vector<const std::type_info *> shared_types;
+
+  cursor(byte_view bytes, endianness endian)
+      : m_data(bytes.data), m_size(bytes.size),
+        m_swap(endian != endianness::native &&
+               endian != get_system_endianness())
+  {}
+
+  size_t remaining() const
+  {
+    return m_size - m_position;
+  }
+  bool at_end() const
+  {
+    return m_position == m_size;
+  }
+
+  bool skip(size_t count)
+  {
+    if (count > remaining())
+      return false;
+    m_position += count;
+    return true;
+  }
+
+  // Skips `count` elements of `width` bytes without overflowing.
+  bool skip(size_t count, size_t width)
+  {
+    return count <= remaining() / width && skip(count * width);
+  }
+
+  bool read_u8(uint8_t &value)
+  {
+    if (remaining() < 1)
+      return false;
+    value = m_data[m_position++];
+    return true;
+  }
+
+  bool read_u32(uint32_t &value)
+  {
+    if (remaining() < sizeof(uint32_t))
+      return false;
+    value = load_value<uint32_t>(m_data + m_position, m_swap);
+    m_position += sizeof(uint32_t);
+    return true;
+  }
+
+  bool read_varint(uint64_t &value)
+  {
+    value = 0;
+    for (int shift = 0; shift < 64 && m_position < m_size; shift += 7)
+    {
+      const uint8_t byte = m_data[m_position++];
+      if (shift == 63 && byte > 1)
+        return false;
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0)
+        return true;
+    }
+    return false;
+  }
+
+  // bool is decoded by memcpy, so any byte other than 0 or 1 is rejected.
+  bool check_bools(size_t count)
+  {
+    if (count > remaining())
+      return false;
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (m_data[m_position + i] > 1)
+        return false;
+    }
+    m_position += count;
+    return true;
+  }
+};
+
+template <typename T, typename = void> struct validator
+{
+  static_assert(std::is_arithmetic_v<T> || is_trivially_serializable_v<T>,
+                "Type not supported by validate");
+
+  static bool walk(cursor &in)
+  {
+    if constexpr (std::is_same_v<T, bool>)
+      return in.check_bools(1);
+    else
+      return in.skip(sizeof(T));
+  }
+};
+
+template <typename T> struct validator<std::complex<T>>
+{
+  static bool walk(cursor &in)
+  {
+    return in.skip(sizeof(std::complex<T>));
+  }
+};
+
+template <size_t N> struct validator<std::bitset<N>>
+{
+  static bool walk(cursor &in)
+  {
+    return in.skip((N + 63) / 64, sizeof(uint64_t));
+  }
+};
+
+template <> struct validator<std::string>
+{
+  static bool walk(cursor &in)
+  {
+    uint32_t length;
+    return in.read_u32(length) && in.skip(length);
+  }
+};
+
+template <> struct validator<std::string_view> : validator<std::string>
+{
+};
+
+template <typename T> bool walk_elements(cursor &in, uint32_t count)
+{
+  if constexpr (std::is_same_v<T, bool>)
+  {
+    return in.check_bools(count);
+  }
+  else if constexpr (std::is_arithmetic_v<T> || is_complex_v<T> ||
+                     is_trivially_serializable_v<T>)
+  {
+    return in.skip(count, sizeof(T));
+  }
+  else
+  {
+    // Every non-arithmetic encoding takes at least one byte.
+    if (count > in.remaining())
+      return false;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      if (!validator<T>::walk(in))
+        return false;
+    }
+    return true;
+  }
+}
+
+template <typename T> struct validator<std::vector<T>>
+{
+  static bool walk(cursor &in)
+  {
+    uint32_t count;
+    return in.read_u32(count) && walk_elements<T>(in, count);
+  }
+};
+
+template <typename T> struct validator<std::deque<T>> : validator<std::vector<T>>
+{
+};
+
+template <typename T> struct validator<std::list<T>> : validator<std::vector<T>>
+{
+};
+
+template <typename T, size_t N> struct validator<std::array<T, N>>
+{
+  static bool walk(cursor &in)
+  {
+    uint32_t count;
+    return in.read_u32(count) && count == N && walk_elements<T>(in, count);
+  }
+};
+
+template <size_t N> struct validator<fixed_string<N>>
+{
+  static bool walk(cursor &in)
+  {
+    uint32_t length;
+    return in.read_u32(length) && length <= N && in.skip(length);
+  }
+};
+
+template <typename T, size_t N> struct validator<static_vector<T, N>>
+{
+  static bool walk(cursor &in)
+  {
+    uint32_t count;
+    return in.read_u32(count) && count <= N && walk_elements<T>(in, count);
+  }
+};
+
+template <typename Map> struct map_validator
+{
+  static bool walk(cursor &in)
+  {
+    uint32_t count;
+    if (!in.read_u32(count) || count > in.remaining())
+      return false;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      if (!validator<typename Map::key_type>::walk(in) ||
+          !validator<typename Map::mapped_type>::walk(in))
+        return false;
+    }
+    return true;
+  }
+};
+
+template <typename K, typename V>
+struct validator<std::map<K, V>> : map_validator<std::map<K, V>>
+{
+};
+
+template <typename K, typename V>
+struct validator<std::unordered_map<K, V>>
+    : map_validator<std::unordered_map<K, V>>
+{
+};
+
+template <typename T> struct validator<std::shared_ptr<T>>
+{
+  static bool walk(cursor &in)
+  {
+    uint64_t id;
+    if (!in.read_varint(id))
+      return false;
+    const std::type_info *type = &typeid(std::remove_const_t<T>);
+    if (id == 0)
+      return true;
+    if (id <= in.shared_types.size())
+      return *in.shared_types[id - 1] == *type;
+    if (id != in.shared_types.size() + 1)
+      return false;
+    in.shared_types.push_back(type);
+    return validator<std::remove_const_t<T>>::walk(in);
+  }
+};
+
+template <typename T> struct validator<std::unique_ptr<T>>
+{
+  static bool walk(cursor &in)
+  {
+    uint8_t present;
+    if (!in.read_u8(present) || present > 1)
+      return false;
+    return present == 0 || validator<T>::walk(in);
+  }
+};
+
+inline bool walk_field(cursor &in, const field &f)
+{
+  if (f.type == field_type::string)
+    return validator<std::string>::walk(in);
+  if (f.type == field_type::boolean)
+    return in.check_bools(1);
+  if (f.type != field_type::array)
+    return in.skip(fixed_width(f.type));
+
+  uint32_t count;
+  if (!in.read_u32(count))
+    return false;
+  if (f.element == field_type::string)
+    return walk_elements<std::string>(in, count);
+  if (f.element == field_type::boolean)
+    return in.check_bools(count);
+  return in.skip(count, fixed_width(f.element));
+}
+
+} // namespace validate_detail
+
+// True when `bytes` holds exactly one well-formed encoding of T.
+template <typename T>
+bool validate(byte_view bytes, endianness endian = endianness::native)
+{
+  validate_detail::cursor in(bytes, endian);
+  return validate_detail::validator<T>::walk(in) && in.at_end();
+}
+
+// True when `bytes` is a whole number of well-formed schema records.
+// Throws std::invalid_argument for an empty schema, which has no record
+// boundaries to check.
+inline bool validate(byte_view bytes, const Schema &schema,
+                     endianness endian = endianness::native)
+{
+  if (schema.size() == 0)
+  {
+    throw std::invalid_argument("Cannot validate records of an empty schema");
+  }
+  validate_detail::cursor in(bytes, endian);
+  while (!in.at_end())
+  {
+    for (const field &f : schema.fields())
+    {
+      if (!validate_detail::walk_field(in, f))
+        return false;
+    }
+  }
+  return true;
+}
+
+}
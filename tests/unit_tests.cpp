@@ -1,8 +1,24 @@
+#include "../include/binary_serializer/arrow.hpp"
 #include "../include/binary_serializer/binary_serializer.hpp"
+#include "../include/binary_serializer/delta.hpp"
+#include "../include/binary_serializer/dispatcher.hpp"
+#include "../include/binary_serializer/encode_cache.hpp"
+#include "../include/binary_serializer/json.hpp"
+#include "../include/binary_serializer/key_encoding.hpp"
+#include "../include/binary_serializer/msgpack.hpp"
+#include "../include/binary_serializer/npy.hpp"
+#include "../include/binary_serializer/projection.hpp"
+#include "../include/binary_serializer/protobuf.hpp"
+#include "../include/binary_serializer/scan.hpp"
+#include "../include/binary_serializer/tracked_serializer.hpp"
+#include "../include/binary_serializer/type_registry.hpp"
+#include "../include/binary_serializer/validate.hpp"
+#include "sample_messages.hpp"
 #include <cassert>
 #include <cmath>
 #include <iostream>
 #include <limits>
+#include <memory_resource>
 #include <sstream>
 #include <numeric>
 #include <chrono>
@@ -17,6 +33,31 @@ void test_limits(class test_runner &runner);
 void test_error_handling(class test_runner &runner);
 void test_buffer_operations(class test_runner &runner);
 void test_performance(class test_runner &runner);
+void test_quantization(class test_runner &runner);
+void test_key_encoding(class test_runner &runner);
+void test_canonical_encoding(class test_runner &runner);
+void test_encode_cache(class test_runner &runner);
+void test_tracked_serializer(class test_runner &runner);
+void test_delta_patch(class test_runner &runner);
+void test_shared_pointers(class test_runner &runner);
+void test_type_registry(class test_runner &runner);
+void test_dispatcher(class test_runner &runner);
+void test_protobuf(class test_runner &runner);
+void test_msgpack(class test_runner &runner);
+void test_json_transcoding(class test_runner &runner);
+void test_generated_code(class test_runner &runner);
+void test_projection(class test_runner &runner);
+void test_record_scan(class test_runner &runner);
+void test_validation(class test_runner &runner);
+void test_utf8_validation(class test_runner &runner);
+void test_arena_decode(class test_runner &runner);
+void test_deserializer_reset(class test_runner &runner);
+void test_fixed_capacity_containers(class test_runner &runner);
+void test_deque_and_list(class test_runner &runner);
+void test_chrono_bitset_complex(class test_runner &runner);
+void test_user_type_extension(class test_runner &runner);
+void test_arrow_interface(class test_runner &runner);
+void test_npy_files(class test_runner &runner);
 
 class test_runner
 {
@@ -37,6 +78,31 @@ public:
     test_error_handling(*this);
     test_buffer_operations(*this);
     test_performance(*this);
+    test_quantization(*this);
+    test_key_encoding(*this);
+    test_canonical_encoding(*this);
+    test_encode_cache(*this);
+    test_tracked_serializer(*this);
+    test_delta_patch(*this);
+    test_shared_pointers(*this);
+    test_type_registry(*this);
+    test_dispatcher(*this);
+    test_protobuf(*this);
+    test_msgpack(*this);
+    test_json_transcoding(*this);
+    test_generated_code(*this);
+    test_projection(*this);
+    test_record_scan(*this);
+    test_validation(*this);
+    test_utf8_validation(*this);
+    test_arena_decode(*this);
+    test_deserializer_reset(*this);
+    test_fixed_capacity_containers(*this);
+    test_deque_and_list(*this);
+    test_chrono_bitset_complex(*this);
+    test_user_type_extension(*this);
+    test_arrow_interface(*this);
+    test_npy_files(*this);
     std::cout << "Tests completed." << std::endl;
 
   }
@@ -321,6 +387,1993 @@ void test_performance(test_runner &runner)
             << iterations << " iterations" << std::endl;
 }
 
+void test_quantization(test_runner &runner)
+{
+  runner.start_test("16-bit quantized double array");
+  std::vector<double> coords(1000);
+  for (size_t i = 0; i < coords.size(); ++i)
+  {
+    coords[i] = 48.0 + 0.001 * static_cast<double>(i);
+  }
+
+  Serializer serializer;
+  serializer.write_quantized(coords, quantization::bits16);
+  auto data = serializer.get_data();
+  runner.check(data.size() < coords.size() * sizeof(double) / 3,
+               "Quantized payload not smaller");
+
+  Deserializer deserializer(data);
+  std::vector<double> decoded;
+  deserializer.read_quantized(decoded);
+  runner.assert_equal(coords.size(), decoded.size());
+
+  double max_error = 0.0;
+  for (size_t i = 0; i < coords.size(); ++i)
+  {
+    max_error = std::max(max_error, std::abs(coords[i] - decoded[i]));
+  }
+  runner.check(max_error < 1e-4, "Quantization error too large");
+
+  runner.start_test("8-bit quantized float array, big endian");
+  std::vector<float> samples = {-1.0f, -0.5f, 0.0f, 0.5f, 1.0f};
+  Serializer big(endianness::big);
+  big.write_quantized(samples, quantization::bits8);
+  Deserializer big_reader(big.get_data(), endianness::big);
+  std::vector<float> decoded_samples;
+  big_reader.read_quantized(decoded_samples);
+  runner.check(std::abs(decoded_samples[0] + 1.0f) < 1e-6 &&
+                   std::abs(decoded_samples[4] - 1.0f) < 1e-6 &&
+                   std::abs(decoded_samples[2]) < 0.01f,
+               "Quantized endpoints not preserved");
+
+  runner.start_test("quantization rejects non-finite values");
+  try
+  {
+    Serializer bad;
+    bad.write_quantized(std::vector<double>{1.0, NAN},
+                        quantization::bits32);
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::runtime_error &)
+  {
+    runner.check(true);
+  }
+
+  runner.start_test("quantized decode rejects bad count and width");
+  int rejected = 0;
+  for (uint8_t width : {uint8_t(1), uint8_t(9)})
+  {
+    Serializer header;
+    header << uint32_t(0xFFFFFFFF) << width << 0.0 << 1.0;
+    try
+    {
+      Deserializer reader(header.get_data());
+      std::vector<double> values;
+      reader.read_quantized(values);
+    }
+    catch (const std::runtime_error &)
+    {
+      ++rejected;
+    }
+  }
+  try
+  {
+    Serializer writer;
+    writer.write_quantized(std::vector<double>{1.0}, quantization(64));
+  }
+  catch (const std::runtime_error &)
+  {
+    ++rejected;
+  }
+  runner.assert_equal(3, rejected);
+}
+
+template <typename T> std::vector<uint8_t> encode_key(const T &value)
+{
+  KeySerializer serializer;
+  serializer << value;
+  return serializer.get_data();
+}
+
+template <typename T> bool keys_ordered(const std::vector<T> &sorted_values)
+{
+  for (size_t i = 1; i < sorted_values.size(); ++i)
+  {
+    auto a = encode_key(sorted_values[i - 1]);
+    auto b = encode_key(sorted_values[i]);
+    if (!std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end()))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void test_key_encoding(test_runner &runner)
+{
+  runner.start_test("key encoding preserves integer order");
+  runner.check(keys_ordered<int32_t>({std::numeric_limits<int32_t>::min(),
+                                      -1000, -1, 0, 1, 255, 256,
+                                      std::numeric_limits<int32_t>::max()}),
+               "Signed integer keys out of order");
+  runner.check(keys_ordered<uint64_t>({0, 1, 0xFF, 0x100, 0xFFFFFFFFFFULL}),
+               "Unsigned integer keys out of order");
+
+  runner.start_test("key encoding preserves float order");
+  runner.check(
+      keys_ordered<double>({-std::numeric_limits<double>::infinity(), -1e300,
+                            -2.5, -1e-300, -0.0, 0.0, 1e-300, 3.0, 1e300,
+                            std::numeric_limits<double>::infinity()}),
+      "Double keys out of order");
+
+  runner.start_test("key encoding preserves string order");
+  runner.check(keys_ordered<std::string>({"", std::string("\0", 1),
+                                          std::string("\0\0", 2), "a",
+                                          std::string("a\0", 2), "ab", "b"}),
+               "String keys out of order");
+
+  runner.start_test("composite key round trip");
+  KeySerializer serializer;
+  serializer << int64_t(-7) << std::string("us\0east", 7) << 1.5f
+             << uint16_t(9);
+  KeyDeserializer deserializer(serializer.get_data());
+  int64_t id;
+  std::string region;
+  float weight;
+  uint16_t shard;
+  deserializer >> id >> region >> weight >> shard;
+  runner.check(id == -7 && region == std::string("us\0east", 7) &&
+                   weight == 1.5f && shard == 9 && !deserializer.has_more(),
+               "Composite key did not round trip");
+
+  runner.start_test("composite keys sort by first field");
+  KeySerializer lower;
+  lower << std::string("abc") << int32_t(100);
+  KeySerializer higher;
+  higher << std::string("abcd") << int32_t(-100);
+  runner.check(lower.get_data() < higher.get_data(),
+               "Prefix string key sorted after longer key");
+}
+
+void test_canonical_encoding(test_runner &runner)
+{
+  runner.start_test("map serialization");
+  std::map<std::string, int32_t> scores = {{"alice", 3}, {"bob", -1}};
+  auto data = serialize(scores);
+  auto decoded_scores = deserialize<std::map<std::string, int32_t>>(data);
+  runner.check(decoded_scores == scores, "Map contents differ");
+
+  runner.start_test("canonical unordered_map ordering");
+  std::unordered_map<int32_t, double> first;
+  std::unordered_map<int32_t, double> second;
+  for (int32_t i = 0; i < 64; ++i)
+  {
+    first[i] = i * 0.5;
+    second[63 - i] = (63 - i) * 0.5;
+  }
+  Serializer a;
+  Serializer b;
+  a.set_canonical(true);
+  b.set_canonical(true);
+  a.enable_hash();
+  b.enable_hash();
+  a << first;
+  b << second;
+  runner.check(a.get_data() == b.get_data(), "Canonical bytes differ");
+  runner.assert_equal(a.hash(), b.hash());
+
+  runner.start_test("streaming hash matches full pass");
+  runner.assert_equal(fnv1a_64(a.get_data().data(), a.get_data().size()),
+                      a.hash());
+
+  runner.start_test("canonical float normalization");
+  double nan_payload;
+  uint64_t nan_bits = 0x7FF8000000000123ULL;
+  std::memcpy(&nan_payload, &nan_bits, sizeof(double));
+  Serializer c;
+  c.set_canonical(true);
+  c << -0.0 << nan_payload;
+  Serializer d;
+  d.set_canonical(true);
+  d << 0.0 << std::numeric_limits<double>::quiet_NaN();
+  runner.check(c.get_data() == d.get_data(), "Floats not normalized");
+
+  runner.start_test("varint round trip");
+  Serializer varints;
+  varints.write_varint(0).write_varint(300).write_varint(UINT64_MAX);
+  varints.write_svarint(-1).write_svarint(INT64_MIN);
+  runner.assert_equal<size_t>(1 + 2 + 10 + 1 + 10, varints.get_data().size());
+  Deserializer varint_reader(varints.get_data());
+  uint64_t u0, u1, u2;
+  int64_t s0, s1;
+  varint_reader.read_varint(u0).read_varint(u1).read_varint(u2);
+  varint_reader.read_svarint(s0).read_svarint(s1);
+  runner.check(u0 == 0 && u1 == 300 && u2 == UINT64_MAX && s0 == -1 &&
+                   s1 == INT64_MIN,
+               "Varints did not round trip");
+
+  runner.start_test("canonical rejects non-minimal varint");
+  try
+  {
+    Deserializer strict(std::vector<uint8_t>{0x81, 0x00});
+    strict.set_canonical(true);
+    uint64_t value;
+    strict.read_varint(value);
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::runtime_error &)
+  {
+    runner.check(true);
+  }
+}
+
+void test_encode_cache(test_runner &runner)
+{
+  runner.start_test("encode cache splices cached bytes");
+  EncodeCache cache;
+  std::map<std::string, std::string> config = {{"region", "eu"},
+                                               {"mode", "fast"}};
+  int encode_calls = 0;
+  auto encode_config = [&](Serializer &encoder, const auto &value)
+  {
+    ++encode_calls;
+    encoder << value;
+  };
+
+  Serializer first;
+  first << uint32_t(1);
+  write_cached(first, cache, config, 1, encode_config);
+  first << uint32_t(2);
+
+  Serializer second;
+  second << uint32_t(1);
+  write_cached(second, cache, config, 1, encode_config);
+  second << uint32_t(2);
+
+  runner.assert_equal(1, encode_calls);
+  runner.check(first.get_data() == second.get_data(),
+               "Cached bytes differ from fresh encoding");
+  runner.assert_equal<size_t>(1, cache.hits());
+
+  Deserializer deserializer(second.get_data());
+  uint32_t head, tail;
+  std::map<std::string, std::string> decoded;
+  deserializer >> head >> decoded >> tail;
+  runner.check(head == 1 && decoded == config && tail == 2,
+               "Spliced message did not decode");
+
+  runner.start_test("encode cache invalidates on version change");
+  config["mode"] = "safe";
+  Serializer third;
+  write_cached(third, cache, config, 2, encode_config);
+  runner.assert_equal(2, encode_calls);
+  runner.check(third.get_data() == serialize(config),
+               "Stale bytes after version bump");
+
+  runner.start_test("encode cache keys on endianness");
+  Serializer big(endianness::big);
+  write_cached(big, cache, config, 2, encode_config);
+  runner.assert_equal(3, encode_calls);
+  runner.check(big.get_data() == serialize(config, endianness::big),
+               "Cached bytes used across endianness");
+
+  runner.start_test("encode cache bypasses stream-dependent encodings");
+  auto p1 = std::make_shared<int32_t>(10);
+  auto p2 = std::make_shared<int32_t>(20);
+  Serializer outer;
+  outer << p1;
+  write_cached(outer, cache, p2, 1);
+  Deserializer shared_in(outer.get_data());
+  std::shared_ptr<int32_t> p1_out, p2_out;
+  shared_in >> p1_out >> p2_out;
+  runner.check(*p1_out == 10 && *p2_out == 20 && cache.find(&p2, 1,
+                   get_system_endianness(), false) == nullptr,
+               "Shared pointer encoding spliced from cache");
+
+  runner.start_test("encode cache remembers uncacheable objects");
+  auto p3 = std::make_shared<int32_t>(30);
+  encode_calls = 0;
+  for (int i = 0; i < 3; ++i)
+  {
+    Serializer repeat;
+    write_cached(repeat, cache, p3, 1, encode_config);
+    runner.check(repeat.get_data() == serialize(p3),
+                 "Uncacheable object encoded wrongly");
+  }
+  runner.assert_equal(4, encode_calls);
+
+  using tick = std::chrono::time_point<std::chrono::system_clock,
+                                       std::chrono::milliseconds>;
+  const tick t1(std::chrono::milliseconds(1000));
+  const tick t2(std::chrono::milliseconds(1500));
+  Serializer timed;
+  timed.set_time_encoding(time_encoding::delta);
+  timed << t1;
+  write_cached(timed, cache, t2, 1);
+  Deserializer timed_in(timed.get_data());
+  timed_in.set_time_encoding(time_encoding::delta);
+  tick t1_out, t2_out;
+  timed_in >> t1_out >> t2_out;
+  runner.check(t1_out == t1 && t2_out == t2, "Delta time spliced from cache");
+
+  const std::chrono::milliseconds timeout(-300);
+  Serializer varint_times;
+  varint_times.set_time_encoding(time_encoding::varint);
+  write_cached(varint_times, cache, timeout, 1);
+  Serializer fixed_times;
+  write_cached(fixed_times, cache, timeout, 1);
+  runner.check(fixed_times.get_data() == serialize(timeout) &&
+                   varint_times.get_data() != fixed_times.get_data(),
+               "Cached bytes used across time encodings");
+}
+
+void test_tracked_serializer(test_runner &runner)
+{
+  runner.start_test("tracked fixed-size field patch");
+  TrackedSerializer tracked;
+  size_t tick = tracked.add(uint64_t(1));
+  size_t name = tracked.add(std::string("node-a"));
+  size_t load = tracked.add(0.25);
+
+  tracked.set(tick, uint64_t(2));
+  tracked.set(load, 0.25);
+  runner.assert_equal<size_t>(1, tracked.dirty_fields().size());
+  runner.check(!tracked.layout_changed(), "Fixed-size patch moved bytes");
+
+  Serializer reference;
+  reference << uint64_t(2) << std::string("node-a") << 0.25;
+  runner.check(tracked.get_data() == reference.get_data(),
+               "Patched bytes differ from full encode");
+
+  runner.start_test("tracked variable-size field splice");
+  tracked.clear_dirty();
+  tracked.set(name, std::string("node-abc"));
+  tracked.set(load, 0.75);
+  runner.check(tracked.layout_changed(), "Resize not reported");
+  runner.assert_equal<size_t>(2, tracked.dirty_fields().size());
+  runner.assert_equal<size_t>(8 + 4 + 8, tracked.field_range(load).offset);
+
+  reference.clear();
+  reference << uint64_t(2) << std::string("node-abc") << 0.75;
+  runner.check(tracked.get_data() == reference.get_data(),
+               "Spliced bytes differ from full encode");
+}
+
+void test_delta_patch(test_runner &runner)
+{
+  std::vector<double> state(20000);
+  std::iota(state.begin(), state.end(), 0.0);
+  auto base = serialize(state);
+
+  runner.start_test("delta patch for in-place changes");
+  state[10] = -1.0;
+  state[15000] = -2.0;
+  auto target = serialize(state);
+  auto patch = make_patch(base, target);
+  runner.check(patch.size() < 128, "Patch not proportional to change");
+  runner.check(apply_patch(base, patch) == target, "Patched bytes differ");
+
+  runner.start_test("delta patch for shifted content");
+  Serializer shifted;
+  shifted << std::string("inserted header") << state;
+  auto shifted_target = shifted.get_data();
+  auto shifted_patch = make_patch(base, shifted_target);
+  runner.check(shifted_patch.size() < 256, "Moved blocks not matched");
+  runner.check(apply_patch(base, shifted_patch) == shifted_target,
+               "Shifted patch bytes differ");
+
+  runner.start_test("delta patch for unrelated and empty inputs");
+  std::vector<uint8_t> unrelated = {1, 2, 3};
+  runner.check(apply_patch(base, make_patch(base, unrelated)) == unrelated,
+               "Unrelated target differs");
+  runner.check(apply_patch({}, make_patch({}, base)) == base,
+               "Empty base patch differs");
+
+  runner.start_test("delta patch rejects wrong base");
+  try
+  {
+    apply_patch(target, patch);
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::runtime_error &)
+  {
+    runner.check(true);
+  }
+
+  runner.start_test("delta patch with hostile target size");
+  Serializer hostile(endianness::little);
+  hostile.write_varint(base.size());
+  hostile << fnv1a_64(base.data(), base.size());
+  hostile.write_varint(UINT64_MAX / 2);
+  try
+  {
+    apply_patch(base, hostile.get_data());
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::runtime_error &)
+  {
+    runner.check(true);
+  }
+}
+
+void test_shared_pointers(test_runner &runner)
+{
+  runner.start_test("shared_ptr deduplication");
+  auto shared = std::make_shared<std::string>(std::string(1000, 'x'));
+  std::vector<std::shared_ptr<std::string>> refs = {shared, nullptr, shared,
+                                                     shared};
+  auto data = serialize(refs);
+  runner.check(data.size() < 4 + 1 + 4 + 1000 + 8, "Shared object duplicated");
+
+  auto decoded = deserialize<std::vector<std::shared_ptr<std::string>>>(data);
+  runner.assert_equal<size_t>(4, decoded.size());
+  runner.check(decoded[0] && *decoded[0] == *shared && !decoded[1] &&
+                   decoded[2] == decoded[0] && decoded[3] == decoded[0],
+               "Shared identity not restored");
+
+  runner.start_test("unique_ptr serialization");
+  Serializer serializer;
+  serializer << std::make_unique<int32_t>(-5) << std::unique_ptr<double>();
+  Deserializer deserializer(serializer.get_data());
+  std::unique_ptr<int32_t> present;
+  auto absent = std::make_unique<double>(1.0);
+  deserializer >> present >> absent;
+  runner.check(present && *present == -5 && !absent,
+               "unique_ptr did not round trip");
+
+  runner.start_test("shared_ptr temporaries are not aliased");
+  Serializer temporaries;
+  for (int32_t i = 0; i < 3; ++i)
+  {
+    temporaries << std::make_shared<int32_t>(100 + i);
+  }
+  Deserializer temporaries_in(temporaries.get_data());
+  std::shared_ptr<int32_t> first, second, third;
+  temporaries_in >> first >> second >> third;
+  runner.check(*first == 100 && *second == 101 && *third == 102,
+               "Freed address reused as a back-reference");
+
+  runner.start_test("shared reference with mismatched type");
+  Serializer mixed;
+  auto number = std::make_shared<int32_t>(7);
+  mixed << number << number;
+  auto mixed_data = mixed.get_data();
+  Serializer entry;
+  entry << uint32_t(1) << number << number;
+  runner.check(
+      validate<std::map<std::shared_ptr<int32_t>, std::shared_ptr<int32_t>>>(
+          entry.get_data()) &&
+          !validate<std::map<std::shared_ptr<int32_t>,
+                             std::shared_ptr<std::string>>>(entry.get_data()),
+      "Mismatched back-reference validated");
+  try
+  {
+    Deserializer confused(mixed_data);
+    std::shared_ptr<int32_t> as_int;
+    std::shared_ptr<std::string> as_string;
+    confused >> as_int >> as_string;
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::runtime_error &)
+  {
+    runner.check(true);
+  }
+
+  runner.start_test("invalid shared reference");
+  try
+  {
+    Deserializer bad(std::vector<uint8_t>{5});
+    std::shared_ptr<int32_t> ptr;
+    bad >> ptr;
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::runtime_error &)
+  {
+    runner.check(true);
+  }
+}
+
+struct shape
+{
+  virtual ~shape() = default;
+  virtual double area() const = 0;
+};
+
+struct circle : shape
+{
+  double radius = 0.0;
+
+  double area() const override
+  {
+    return 3.0 * radius * radius;
+  }
+  void serialize(Serializer &serializer) const
+  {
+    serializer << radius;
+  }
+  void deserialize(Deserializer &deserializer)
+  {
+    deserializer >> radius;
+  }
+};
+
+struct rectangle : shape
+{
+  float width = 0.0f;
+  float height = 0.0f;
+
+  double area() const override
+  {
+    return width * height;
+  }
+  void serialize(Serializer &serializer) const
+  {
+    serializer << width << height;
+  }
+  void deserialize(Deserializer &deserializer)
+  {
+    deserializer >> width >> height;
+  }
+};
+
+void test_type_registry(test_runner &runner)
+{
+  circle c;
+  c.radius = 2.0;
+  rectangle r;
+  r.width = 3.0f;
+  r.height = 4.0f;
+
+  runner.start_test("runtime type registry round trip");
+  TypeRegistry<shape> registry;
+  registry.add<circle>();
+  registry.add<rectangle>(7);
+  runner.assert_equal<uint32_t>(7, registry.id_of<rectangle>());
+
+  Serializer serializer;
+  const shape &as_circle = c;
+  const shape &as_rectangle = r;
+  registry.write(serializer, as_rectangle);
+  registry.write(serializer, as_circle);
+
+  Deserializer deserializer(serializer.get_data());
+  auto first = registry.read(deserializer);
+  auto second = registry.read(deserializer);
+  runner.check(dynamic_cast<rectangle *>(first.get()) != nullptr &&
+                   first->area() == 12.0 &&
+                   dynamic_cast<circle *>(second.get()) != nullptr &&
+                   second->area() == 12.0,
+               "Polymorphic objects did not round trip");
+
+  runner.start_test("runtime type registry rejects bad registrations");
+  int rejected = 0;
+  auto expect_reject = [&](auto &&add)
+  {
+    try
+    {
+      add();
+    }
+    catch (const std::invalid_argument &)
+    {
+      ++rejected;
+    }
+  };
+  TypeRegistry<shape> fresh;
+  expect_reject([&] { registry.add<circle>(3); });
+  expect_reject([&] { fresh.add<circle>(UINT32_MAX); });
+  expect_reject([&] { fresh.add<circle>(TypeRegistry<shape>::max_id + 1); });
+  fresh.add<circle>(TypeRegistry<shape>::max_id);
+  expect_reject([&] { fresh.add<rectangle>(TypeRegistry<shape>::max_id); });
+  runner.check(rejected == 4 && fresh.id_of<circle>() ==
+                                    TypeRegistry<shape>::max_id,
+               "Invalid registration accepted");
+
+  runner.start_test("static type registry round trip");
+  using shapes = StaticTypeRegistry<shape, circle, rectangle>;
+  static_assert(shapes::id_of<rectangle>() == 1, "Unexpected static ID");
+  Serializer static_serializer;
+  shapes::write(static_serializer, r);
+  shapes::write(static_serializer, as_circle);
+  runner.check(static_serializer.get_data()[0] == 1,
+               "Static ID not written first");
+
+  Deserializer static_deserializer(static_serializer.get_data());
+  auto decoded_rectangle = shapes::read(static_deserializer);
+  auto decoded_circle = shapes::read(static_deserializer);
+  runner.check(decoded_rectangle->area() == 12.0 &&
+                   dynamic_cast<circle *>(decoded_circle.get()) != nullptr,
+               "Static registry did not round trip");
+
+  runner.start_test("unknown type ID");
+  try
+  {
+    Deserializer bad(std::vector<uint8_t>{3});
+    registry.read(bad);
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::runtime_error &)
+  {
+    runner.check(true);
+  }
+}
+
+void test_dispatcher(test_runner &runner)
+{
+  Serializer stream;
+  for (int32_t i = 0; i < 3; ++i)
+  {
+    Serializer tick;
+    tick << std::string("EURUSD") << 1.1 + i;
+    write_frame(stream, 2, tick);
+
+    Serializer heartbeat;
+    heartbeat << uint64_t(100 + i);
+    write_frame(stream, 0, heartbeat);
+  }
+  auto frames = stream.get_data();
+
+  std::vector<std::string> order;
+  std::vector<uint64_t> heartbeats;
+  std::string_view last_symbol;
+  Dispatcher dispatcher;
+  dispatcher.on<uint64_t>(0, [&](const uint64_t &value)
+                          {
+                            order.push_back("heartbeat");
+                            heartbeats.push_back(value);
+                          });
+  dispatcher.on(2, [&](Deserializer &deserializer)
+                {
+                  order.push_back("tick");
+                  deserializer >> last_symbol;
+                });
+
+  runner.start_test("dispatcher stream order");
+  runner.assert_equal<size_t>(6, dispatcher.dispatch(frames));
+  runner.check(order[0] == "tick" && order[1] == "heartbeat" &&
+                   heartbeats.back() == 102,
+               "Messages not dispatched in order");
+
+  runner.start_test("dispatcher zero-copy payload");
+  const auto *begin = reinterpret_cast<const char *>(frames.data());
+  runner.check(last_symbol == "EURUSD" && last_symbol.data() > begin &&
+                   last_symbol.data() < begin + frames.size(),
+               "Payload was copied");
+
+  runner.start_test("dispatcher batches by type");
+  order.clear();
+  dispatcher.dispatch_batched(frames);
+  runner.check(order ==
+                   std::vector<std::string>{"heartbeat", "heartbeat",
+                                            "heartbeat", "tick", "tick", "tick"},
+               "Messages not grouped by type");
+
+  runner.start_test("dispatcher reusable after a handler throws");
+  Dispatcher strict;
+  size_t handled = 0;
+  strict.on(1, [&](Deserializer &deserializer)
+            {
+              uint32_t value;
+              deserializer >> value;
+              ++handled;
+            });
+  Serializer truncated;
+  write_frame(truncated, 1, nullptr, 0);
+  write_frame(truncated, 1, nullptr, 0);
+  bool threw = false;
+  {
+    auto bad_frames = truncated.get_data();
+    try
+    {
+      strict.dispatch_batched(bad_frames);
+    }
+    catch (const std::runtime_error &)
+    {
+      threw = true;
+    }
+  }
+  Serializer good_payload;
+  good_payload << uint32_t(9);
+  Serializer good;
+  write_frame(good, 1, good_payload);
+  strict.dispatch_batched(good.get_data());
+  runner.check(threw && handled == 1, "Stale batch entries replayed");
+
+  runner.start_test("dispatcher rejects unknown type");
+  Serializer unknown;
+  write_frame(unknown, 5, nullptr, 0);
+  try
+  {
+    dispatcher.dispatch(unknown.get_data());
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::runtime_error &)
+  {
+    runner.check(true);
+  }
+
+  runner.start_test("dispatcher rejects oversized type ID");
+  int rejected = 0;
+  for (uint32_t id : {Dispatcher::max_id + 1, uint32_t(UINT32_MAX)})
+  {
+    try
+    {
+      strict.on(id, [](Deserializer &) {});
+    }
+    catch (const std::invalid_argument &)
+    {
+      ++rejected;
+    }
+  }
+  strict.on(Dispatcher::max_id, [](Deserializer &) {});
+  runner.check(rejected == 2 && strict.has_handler(Dispatcher::max_id) &&
+                   !strict.has_handler(Dispatcher::max_id + 1),
+               "Oversized type ID accepted");
+}
+
+void test_protobuf(test_runner &runner)
+{
+  runner.start_test("protobuf reference encoding");
+  ProtoWriter writer;
+  writer.write_uint(1, 150);
+  writer.write_string(2, "testing");
+  writer.write_packed_varint(4, std::vector<int32_t>{3, 270, 86942});
+  std::vector<uint8_t> expected = {0x08, 0x96, 0x01, 0x12, 0x07, 0x74, 0x65,
+                                   0x73, 0x74, 0x69, 0x6e, 0x67, 0x22, 0x06,
+                                   0x03, 0x8E, 0x02, 0x9E, 0xA7, 0x05};
+  runner.check(writer.get_data() == expected, "Wire bytes differ");
+
+  runner.start_test("protobuf round trip");
+  std::vector<double> samples = {1.5, -2.25, 1e10};
+  writer.clear();
+  writer.write_sint(1, -3)
+      .write_int(2, -1)
+      .write_fixed<float>(3, 0.5f)
+      .write_packed_fixed(4, samples)
+      .write_packed_sint(5, std::vector<int64_t>{-1, 1, -64})
+      .write_message(6, [](ProtoWriter &child)
+                     { child.write_bool(1, true).write_string(2, "inner"); })
+      .write_fixed<uint64_t>(99, 7);
+  auto data = writer.get_data();
+
+  ProtoReader reader(data);
+  int64_t sint = 0, plain = 0;
+  float ratio = 0.0f;
+  std::vector<double> decoded_samples;
+  std::vector<int64_t> deltas;
+  bool flag = false;
+  std::string_view name;
+  while (reader.next())
+  {
+    switch (reader.field())
+    {
+    case 1:
+      sint = reader.read_sint();
+      break;
+    case 2:
+      plain = reader.read_int();
+      break;
+    case 3:
+      ratio = reader.read_fixed<float>();
+      break;
+    case 4:
+      reader.read_packed_fixed(decoded_samples);
+      break;
+    case 5:
+      reader.read_packed_sint(deltas);
+      break;
+    case 6:
+    {
+      ProtoReader child = reader.read_message();
+      while (child.next())
+      {
+        if (child.field() == 1)
+          flag = child.read_bool();
+        else
+          name = child.read_string();
+      }
+      break;
+    }
+    default:
+      reader.skip();
+    }
+  }
+  runner.check(sint == -3 && plain == -1 && ratio == 0.5f &&
+                   decoded_samples == samples &&
+                   deltas == std::vector<int64_t>{-1, 1, -64} && flag &&
+                   name == "inner",
+               "Protobuf fields did not round trip");
+
+  runner.start_test("protobuf wire type mismatch");
+  ProtoReader mismatched(expected);
+  mismatched.next();
+  try
+  {
+    mismatched.read_string();
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::runtime_error &)
+  {
+    runner.check(true);
+  }
+}
+
+void test_msgpack(test_runner &runner)
+{
+  runner.start_test("msgpack reference encoding");
+  MsgPackSerializer serializer;
+  serializer << std::map<std::string, bool>{{"compact", true}}
+             << int32_t(-1) << uint16_t(200) << int64_t(-33) << nullptr;
+  std::vector<uint8_t> expected = {0x81, 0xa7, 'c',  'o',  'm',  'p',  'a',
+                                   'c',  't',  0xc3, 0xff, 0xcc, 0xc8, 0xd0,
+                                   0xdf, 0xc0};
+  runner.check(serializer.get_data() == expected, "Wire bytes differ");
+
+  runner.start_test("msgpack round trip");
+  std::vector<double> samples = {0.5, -1.25, 1e300};
+  std::vector<uint8_t> blob = {0, 1, 2, 255};
+  serializer.clear();
+  serializer << samples << blob << std::string(40, 'x') << uint64_t(1) << 7.5f
+             << std::array<int16_t, 2>{-300, 300};
+  MsgPackDeserializer deserializer(serializer.get_data());
+  std::vector<double> decoded_samples;
+  std::vector<uint8_t> decoded_blob;
+  std::string text;
+  uint8_t small;
+  double widened;
+  std::array<int16_t, 2> pair;
+  deserializer >> decoded_samples >> decoded_blob >> text >> small >>
+      widened >> pair;
+  runner.check(decoded_samples == samples && decoded_blob == blob &&
+                   text == std::string(40, 'x') && small == 1 &&
+                   widened == 7.5 && pair[0] == -300 && pair[1] == 300 &&
+                   !deserializer.has_more(),
+               "MessagePack values did not round trip");
+
+  runner.start_test("msgpack integer range check");
+  MsgPackSerializer large;
+  large << int32_t(-5) << uint32_t(70000);
+  MsgPackDeserializer narrow(large.get_data());
+  try
+  {
+    uint8_t unsigned_target;
+    narrow >> unsigned_target;
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::runtime_error &)
+  {
+    runner.check(true);
+  }
+}
+
+void test_json_transcoding(test_runner &runner)
+{
+  Schema schema;
+  schema.add("id", field_type::uint32)
+      .add("name", field_type::string)
+      .add("price", field_type::float64)
+      .add("active", field_type::boolean)
+      .add_array("tags", field_type::string)
+      .add_array("levels", field_type::int16);
+
+  Serializer serializer;
+  serializer << uint32_t(7) << std::string("say \"hi\"\n") << 0.1 << true
+             << std::vector<std::string>{"a", "b"}
+             << std::vector<int16_t>{-1, 300};
+  serializer << uint32_t(8) << std::string("x") << -2.5 << false
+             << std::vector<std::string>{} << std::vector<int16_t>{};
+  auto records = serializer.get_data();
+
+  runner.start_test("binary to JSON");
+  std::ostringstream json;
+  runner.assert_equal<size_t>(2, records_to_json(schema, records, json));
+  const std::string expected =
+      "{\"id\":7,\"name\":\"say \\\"hi\\\"\\n\",\"price\":0.1,"
+      "\"active\":true,\"tags\":[\"a\",\"b\"],\"levels\":[-1,300]}\n"
+      "{\"id\":8,\"name\":\"x\",\"price\":-2.5,\"active\":false,"
+      "\"tags\":[],\"levels\":[]}\n";
+  runner.assert_equal(expected, json.str());
+
+  runner.start_test("JSON to binary round trip");
+  Serializer encoded;
+  runner.assert_equal<size_t>(2, json_to_records(schema, json.str(), encoded));
+  runner.check(encoded.get_data() == records, "Re-encoded bytes differ");
+
+  runner.start_test("JSON keys in any order with unicode escapes");
+  Serializer reordered;
+  json_to_record(schema,
+                 "{ \"levels\": [1], \"extra\": {\"x\": [null]},"
+                 " \"tags\": [\"\\u00e9\\ud83c\\udf0d\"], \"active\": false,"
+                 " \"price\": 1e3, \"name\": \"\", \"id\": 4294967295 }",
+                 reordered);
+  Deserializer check(reordered.get_data());
+  uint32_t id;
+  std::string name;
+  double price;
+  bool active;
+  std::vector<std::string> tags;
+  std::vector<int16_t> levels;
+  check >> id >> name >> price >> active >> tags >> levels;
+  runner.check(id == 4294967295u && name.empty() && price == 1000.0 &&
+                   !active && tags.size() == 1 &&
+                   tags[0] == "\xC3\xA9\xF0\x9F\x8C\x8D" &&
+                   levels == std::vector<int16_t>{1},
+               "Reordered JSON did not encode");
+
+  runner.start_test("JSON out of range integer");
+  try
+  {
+    Serializer bad;
+    json_to_record(schema,
+                   "{\"id\":-1,\"name\":\"\",\"price\":0,\"active\":true,"
+                   "\"tags\":[],\"levels\":[]}",
+                   bad);
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::runtime_error &)
+  {
+    runner.check(true);
+  }
+
+  runner.start_test("failed JSON record leaves output unchanged");
+  Serializer partial;
+  partial << uint8_t(0xAB);
+  const std::string good =
+      "{\"id\":1,\"name\":\"a\",\"price\":0,\"active\":true,"
+      "\"tags\":[],\"levels\":[]}";
+  const std::string bad =
+      "{\"id\":2,\"name\":\"b\",\"price\":0,\"active\":true,"
+      "\"tags\":[],\"levels\":[70000]}";
+  int failures = 0;
+  try
+  {
+    json_to_record(schema, bad, partial);
+  }
+  catch (const std::runtime_error &)
+  {
+    ++failures;
+  }
+  try
+  {
+    json_to_records(schema, good + "\n" + bad + "\n", partial);
+  }
+  catch (const std::runtime_error &)
+  {
+    ++failures;
+  }
+  runner.check(failures == 2 && partial.get_data() == std::vector<uint8_t>{0xAB},
+               "Failed JSON decode left partial bytes");
+
+  runner.start_test("JSON transcoding rejects empty schema");
+  try
+  {
+    std::ostringstream sink;
+    records_to_json(Schema(), std::vector<uint8_t>{1, 2, 3}, sink);
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::invalid_argument &)
+  {
+    runner.check(true);
+  }
+}
+
+void test_generated_code(test_runner &runner)
+{
+  sample::Quote quote;
+  quote.id = 42;
+  quote.bid = 1.25;
+  quote.ask = 1.5;
+  quote.active = true;
+  quote.symbol = "EURUSD";
+  quote.levels = {-3, 7};
+  quote.flags = {1, 2, 3, 4};
+  quote.timestamp = -99;
+  quote.origin = {0.5, -0.5};
+  quote.tags = {"fx", "spot"};
+  quote.path = {{1.0, 2.0}, {3.0, 4.0}};
+
+  runner.start_test("generated static sizes");
+  static_assert(sample::Point::is_fixed_size, "Point should be fixed size");
+  static_assert(!sample::Quote::is_fixed_size, "Quote is variable size");
+  runner.assert_equal<size_t>(16, sample::encoded_size(quote.origin));
+
+  for (auto endian : {endianness::little, endianness::big})
+  {
+    runner.start_test("generated encode matches Serializer");
+    Buffer buffer(endian);
+    sample::encode(buffer, quote);
+
+    Serializer serializer(endian);
+    serializer << quote.id << quote.bid << quote.ask << quote.active
+               << quote.symbol << quote.levels << quote.flags << quote.timestamp
+               << quote.origin.x << quote.origin.y << quote.tags
+               << uint32_t(2) << 1.0 << 2.0 << 3.0 << 4.0;
+    runner.check(buffer.vector() == serializer.get_data(),
+                 "Generated bytes differ");
+    runner.assert_equal(sample::encoded_size(quote), buffer.size());
+
+    runner.start_test("generated decode round trip");
+    Buffer input(buffer.vector(), endian);
+    sample::Quote decoded;
+    sample::decode(input, decoded);
+    runner.check(decoded.id == 42 && decoded.ask == 1.5 && decoded.active &&
+                     decoded.symbol == "EURUSD" &&
+                     decoded.levels == quote.levels &&
+                     decoded.flags == quote.flags && decoded.timestamp == -99 &&
+                     decoded.origin.y == -0.5 && decoded.tags == quote.tags &&
+                     decoded.path.size() == 2 && decoded.path[1].x == 3.0 &&
+                     input.position() == input.size(),
+                 "Generated decode differs");
+
+    runner.start_test("generated large array round trip");
+    sample::Samples samples;
+    samples.channel = 9;
+    for (int32_t i = 0; i < 60; ++i)
+    {
+      samples.first[i] = i;
+      samples.second[i] = -i;
+    }
+    for (size_t i = 0; i < samples.values.size(); ++i)
+      samples.values[i] = static_cast<float>(i) * 0.5f;
+    samples.tail = 7;
+    Buffer sample_buffer(endian);
+    sample::encode(sample_buffer, samples);
+    runner.assert_equal(sample::encoded_size(samples), sample_buffer.size());
+    Buffer sample_input(sample_buffer.vector(), endian);
+    sample::Samples sample_decoded;
+    sample::decode(sample_input, sample_decoded);
+    runner.check(sample_decoded.channel == 9 &&
+                     sample_decoded.first == samples.first &&
+                     sample_decoded.second == samples.second &&
+                     sample_decoded.values == samples.values &&
+                     sample_decoded.tail == 7,
+                 "Large array did not round trip");
+  }
+
+  runner.start_test("generated encode grows buffer geometrically");
+  Buffer appended;
+  size_t growths = 0;
+  for (int i = 0; i < 10000; ++i)
+  {
+    const size_t capacity = appended.capacity();
+    sample::encode(appended, quote.origin);
+    if (appended.capacity() != capacity)
+      ++growths;
+  }
+  runner.check(appended.size() == 160000 && growths < 40,
+               "Generated encode reallocated on every call");
+}
+
+void test_projection(test_runner &runner)
+{
+  Schema schema;
+  schema.add("id", field_type::uint64)
+      .add("comment", field_type::string)
+      .add_array("samples", field_type::float64)
+      .add("symbol", field_type::string)
+      .add_array("tags", field_type::string)
+      .add("price", field_type::float64);
+
+  Serializer serializer;
+  for (uint64_t i = 0; i < 3; ++i)
+  {
+    serializer << i << std::string(100, 'c') << std::vector<double>(50, 1.0)
+               << std::string("SYM") + std::to_string(i)
+               << std::vector<std::string>{"x", "y"} << 10.0 * i;
+  }
+  auto data = serializer.get_data();
+
+  runner.start_test("projection reads requested fields");
+  Projection projection(schema, {"price", "symbol"});
+  Deserializer deserializer(data);
+  double price_sum = 0.0;
+  std::string_view symbol;
+  size_t records = 0;
+  while (deserializer.has_more())
+  {
+    double price;
+    projection.read_values(deserializer, price, symbol);
+    price_sum += price;
+    ++records;
+  }
+  runner.assert_equal<size_t>(3, records);
+  runner.check(price_sum == 30.0 && symbol == "SYM2",
+               "Projected values differ");
+
+  runner.start_test("projection visitor may read partially");
+  Projection first_tag(schema, {"tags"});
+  Deserializer partial(data);
+  std::vector<std::string_view> firsts;
+  while (partial.has_more())
+  {
+    first_tag.read(partial, [&](size_t, Deserializer &in)
+                   {
+                     uint32_t count;
+                     std::string_view tag;
+                     in >> count >> tag;
+                     firsts.push_back(tag);
+                   });
+  }
+  runner.check(firsts.size() == 3 && firsts[2] == "x",
+               "Partial read misaligned records");
+
+  runner.start_test("deserializer skip");
+  Deserializer skipper(data);
+  skipper.skip<uint64_t>()
+      .skip<std::string>()
+      .skip<std::vector<double>>()
+      .skip<std::string>()
+      .skip<std::vector<std::string>>();
+  double price;
+  skipper >> price;
+  runner.check(price == 0.0 && skipper.position() == data.size() / 3,
+               "Skip landed on wrong offset");
+}
+
+void test_record_scan(test_runner &runner)
+{
+  Schema ticks;
+  ticks.add("ts", field_type::int64)
+      .add("venue", field_type::uint8)
+      .add("price", field_type::float64)
+      .add("qty", field_type::uint32);
+
+  Serializer fixed(endianness::big);
+  for (int64_t i = 0; i < 1000; ++i)
+  {
+    fixed << i << uint8_t(i % 4) << 100.0 + i * 0.5 << uint32_t(i % 7);
+  }
+  auto fixed_log = fixed.get_data();
+
+  runner.start_test("fixed-stride predicate scan");
+  RecordScanner scanner(ticks, endianness::big);
+  scanner.where("venue", compare_op::equal, 2)
+      .where_between("price", 200.0, 300.0)
+      .where("ts", compare_op::not_equal, 300);
+  size_t matches = 0;
+  int64_t ts_sum = 0;
+  size_t found = scanner.scan(fixed_log, [&](Deserializer &record)
+                              {
+                                int64_t ts;
+                                record >> ts;
+                                ts_sum += ts;
+                                ++matches;
+                              });
+  int64_t expected_sum = 0;
+  size_t expected_matches = 0;
+  for (int64_t i = 200; i <= 400; ++i)
+  {
+    if (i % 4 == 2 && i != 300)
+    {
+      expected_sum += i;
+      ++expected_matches;
+    }
+  }
+  runner.check(found == matches && matches == expected_matches &&
+                   ts_sum == expected_sum,
+               "Fixed-stride scan matched wrong records");
+
+  runner.start_test("variable-length predicate scan");
+  Schema orders;
+  orders.add("id", field_type::uint32)
+      .add("note", field_type::string)
+      .add_array("fills", field_type::float32)
+      .add("symbol", field_type::string)
+      .add("side", field_type::int8);
+  Serializer variable;
+  const char *symbols[] = {"AAPL", "MSFT", "AAPL"};
+  for (uint32_t i = 0; i < 30; ++i)
+  {
+    variable << i << std::string(i, 'n') << std::vector<float>(i % 5, 1.0f)
+             << std::string(symbols[i % 3]) << int8_t(i % 2 ? -1 : 1);
+  }
+  RecordScanner order_scanner(orders);
+  order_scanner.where("symbol", compare_op::equal, "AAPL")
+      .where("side", compare_op::less, 0);
+  std::vector<uint32_t> ids;
+  order_scanner.scan(variable.get_data(), [&](Deserializer &record)
+                     {
+                       uint32_t id;
+                       record >> id;
+                       ids.push_back(id);
+                     });
+  runner.check(ids.size() == 10 && ids[0] == 3 && ids[1] == 5 &&
+                   ids.back() == 29,
+               "Variable-length scan matched wrong records");
+
+  runner.start_test("predicate operand range check");
+  try
+  {
+    RecordScanner(ticks).where("qty", compare_op::less, -1);
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::invalid_argument &)
+  {
+    runner.check(true);
+  }
+
+  runner.start_test("fractional operand on integer field");
+  RecordScanner fractional(ticks, endianness::big);
+  fractional.where("ts", compare_op::less, 2.5)
+      .where("qty", compare_op::greater, -1.5)
+      .where("venue", compare_op::less_equal, 1e300);
+  size_t below = fractional.scan(fixed_log, [](Deserializer &) {});
+  RecordScanner whole(ticks, endianness::big);
+  whole.where("ts", compare_op::greater_equal, 998.0);
+  size_t above = whole.scan(fixed_log, [](Deserializer &) {});
+  runner.check(below == 3 && above == 2,
+               "Fractional operand was truncated on an integer field");
+
+  runner.start_test("scan rejects empty schema");
+  try
+  {
+    Schema empty;
+    RecordScanner empty_scanner(empty);
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::invalid_argument &)
+  {
+    runner.check(true);
+  }
+}
+
+void test_validation(test_runner &runner)
+{
+  using message = std::map<std::string, std::vector<std::string>>;
+  message value = {{"a", {"x", "yy"}}, {"b", {}}};
+  auto data = serialize(value, endianness::big);
+
+  runner.start_test("validate accepts well-formed input");
+  runner.check(validate<message>(data, endianness::big), "Valid input rejected");
+  runner.check(!validate<message>(data, endianness::little),
+               "Wrong byte order accepted");
+
+  runner.start_test("validate rejects truncation and trailing bytes");
+  bool all_truncations_rejected = true;
+  for (size_t size = 0; size < data.size(); ++size)
+  {
+    if (validate<message>(byte_view(data.data(), size), endianness::big))
+      all_truncations_rejected = false;
+  }
+  runner.check(all_truncations_rejected, "Truncated input accepted");
+  auto padded = data;
+  padded.push_back(0);
+  runner.check(!validate<message>(padded, endianness::big),
+               "Trailing bytes accepted");
+
+  runner.start_test("validate rejects oversized counts");
+  std::vector<uint8_t> huge = {0xFF, 0xFF, 0xFF, 0x7F, 0, 0, 0, 0};
+  runner.check(!validate<std::vector<std::string>>(huge) &&
+                   !validate<std::vector<double>>(huge),
+               "Oversized count accepted");
+
+  runner.start_test("validate shared references and bools");
+  auto shared = std::make_shared<int32_t>(5);
+  auto refs = serialize(std::vector<std::shared_ptr<int32_t>>{shared, shared});
+  runner.check(validate<std::vector<std::shared_ptr<int32_t>>>(refs),
+               "Shared references rejected");
+  refs[refs.size() - 1] = 9;
+  runner.check(!validate<std::vector<std::shared_ptr<int32_t>>>(refs),
+               "Dangling reference accepted");
+  runner.check(!validate<bool>(std::vector<uint8_t>{2}), "Bad bool accepted");
+
+  runner.start_test("validate schema records");
+  Schema schema;
+  schema.add("id", field_type::uint16).add_array("names", field_type::string);
+  Serializer records;
+  records << uint16_t(1) << std::vector<std::string>{"a"} << uint16_t(2)
+          << std::vector<std::string>{};
+  auto record_bytes = records.get_data();
+  runner.check(validate(record_bytes, schema), "Valid records rejected");
+  record_bytes.pop_back();
+  runner.check(!validate(record_bytes, schema), "Truncated record accepted");
+
+  runner.start_test("validate rejects empty schema");
+  try
+  {
+    validate(record_bytes, Schema());
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::invalid_argument &)
+  {
+    runner.check(true);
+  }
+}
+
+void test_utf8_validation(test_runner &runner)
+{
+  auto valid = [](const std::string &text) {
+    return is_valid_utf8(reinterpret_cast<const uint8_t *>(text.data()),
+                         text.size());
+  };
+
+  runner.start_test("UTF-8 validator accepts well-formed text");
+  std::string long_ascii(100, 'a');
+  runner.check(valid("") && valid(long_ascii) &&
+                   valid(long_ascii + "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80" +
+                         long_ascii),
+               "Valid UTF-8 rejected");
+
+  runner.start_test("UTF-8 validator rejects malformed text");
+  runner.check(!valid(long_ascii + "\xC0\xAF"), "Overlong accepted");
+  runner.check(!valid("\xED\xA0\x80"), "Surrogate accepted");
+  runner.check(!valid("\xF4\x90\x80\x80"), "Beyond U+10FFFF accepted");
+  runner.check(!valid(long_ascii + "\xE2\x82"), "Truncated sequence accepted");
+  runner.check(!valid("\x80"), "Stray continuation accepted");
+
+  runner.start_test("Deserializer validates strings when enabled");
+  Serializer serializer;
+  serializer << std::string("caf\xC3\xA9") << std::string("bad\xFF");
+  auto data = serializer.get_data();
+
+  Deserializer lenient(data);
+  std::string first, second;
+  lenient >> first >> second;
+  runner.check(second == "bad\xFF", "Validation applied when disabled");
+
+  Deserializer strict(data);
+  strict.set_validate_utf8(true);
+  std::string_view view;
+  strict >> view;
+  runner.check(view == "caf\xC3\xA9", "Valid string rejected");
+  bool threw = false;
+  try
+  {
+    strict >> second;
+  }
+  catch (const std::runtime_error &)
+  {
+    threw = true;
+  }
+  runner.check(threw, "Invalid UTF-8 accepted");
+}
+
+// Counts allocations reaching the upstream of a decoder's arena.
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+  size_t allocations = 0;
+
+private:
+  void *do_allocate(size_t bytes, size_t alignment) override
+  {
+    ++allocations;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+  void do_deallocate(void *p, size_t bytes, size_t alignment) override
+  {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override
+  {
+    return this == &other;
+  }
+};
+
+void test_arena_decode(test_runner &runner)
+{
+  std::vector<std::string> names;
+  for (int i = 0; i < 50; ++i)
+    names.push_back("a string long enough to defeat SSO #" + std::to_string(i));
+  Serializer serializer;
+  serializer << names << std::vector<double>{1.5, 2.5}
+             << std::string("trailing string beyond small-string size");
+  auto data = serializer.get_data();
+
+  runner.start_test("arena decode of pmr containers");
+  Deserializer deserializer(data);
+  deserializer.use_arena();
+  auto decoded = deserializer.make<std::pmr::vector<std::pmr::string>>();
+  auto values = deserializer.make<std::pmr::vector<double>>();
+  auto tail = deserializer.make<std::pmr::string>();
+  deserializer >> decoded >> values >> tail;
+  runner.check(decoded.size() == 50 && std::string_view(decoded[49]) == names[49] &&
+                   values[1] == 2.5 &&
+                   tail == "trailing string beyond small-string size",
+               "Arena decode mismatch");
+  runner.check(decoded[0].get_allocator().resource() ==
+                   deserializer.memory_resource(),
+               "Nested strings not allocated from the arena");
+
+  runner.start_test("pmr containers round trip");
+  Serializer again;
+  again << decoded << values << tail;
+  runner.check(again.get_data() == data, "pmr encoding differs");
+
+  runner.start_test("arena draws few upstream blocks");
+  counting_resource upstream;
+  std::pmr::monotonic_buffer_resource arena(1024, &upstream);
+  Deserializer counted(data);
+  std::pmr::vector<std::pmr::string> strings(&arena);
+  counted >> strings;
+  runner.check(strings.size() == 50 && upstream.allocations < 10,
+               "Arena allocated per string");
+}
+
+void test_deserializer_reset(test_runner &runner)
+{
+  std::vector<std::vector<uint8_t>> messages;
+  for (uint32_t i = 0; i < 3; ++i)
+  {
+    auto shared = std::make_shared<uint32_t>(i);
+    messages.push_back(serialize(
+        std::vector<std::shared_ptr<uint32_t>>{shared, shared}, endianness::big));
+  }
+
+  runner.start_test("reset rebinds to new input");
+  Deserializer deserializer(byte_view(), endianness::big);
+  deserializer.set_validate_utf8(true);
+  bool all_match = true;
+  for (uint32_t i = 0; i < messages.size(); ++i)
+  {
+    deserializer.reset(messages[i]);
+    std::vector<std::shared_ptr<uint32_t>> decoded;
+    deserializer >> decoded;
+    all_match = all_match && decoded.size() == 2 && *decoded[0] == i &&
+                decoded[0] == decoded[1] && !deserializer.has_more();
+  }
+  runner.check(all_match, "Reset decode mismatch");
+
+  runner.start_test("reset binds lvalue vectors in place");
+  std::vector<uint8_t> borrowed = serialize(uint32_t(1), endianness::big);
+  deserializer.reset(borrowed);
+  borrowed[3] = 2;
+  uint32_t seen = 0;
+  deserializer >> seen;
+  runner.assert_equal<uint32_t>(2, seen);
+
+  runner.start_test("reset keeps modes and accepts owned input");
+  deserializer.reset(serialize(std::string("\xFF"), endianness::big));
+  bool threw = false;
+  try
+  {
+    std::string text;
+    deserializer >> text;
+  }
+  catch (const std::runtime_error &)
+  {
+    threw = true;
+  }
+  runner.check(threw, "UTF-8 validation lost on reset");
+}
+
+void test_fixed_capacity_containers(test_runner &runner)
+{
+  runner.start_test("fixed_string and static_vector round trip");
+  fixed_string<8> symbol("AAPL");
+  static_vector<int32_t, 4> levels = {1, -2, 3};
+  static_vector<fixed_string<4>, 2> codes = {fixed_string<4>("XN"),
+                                             fixed_string<4>("ARCA")};
+  Serializer serializer(endianness::big);
+  serializer << symbol << levels << codes;
+  auto data = serializer.get_data();
+
+  Deserializer deserializer(data, endianness::big);
+  fixed_string<8> symbol_out;
+  static_vector<int32_t, 4> levels_out;
+  static_vector<fixed_string<4>, 2> codes_out;
+  deserializer >> symbol_out >> levels_out >> codes_out;
+  runner.check(symbol_out == symbol && levels_out == levels &&
+                   codes_out == codes,
+               "Fixed-capacity round trip mismatch");
+
+  runner.start_test("fixed-capacity encoding matches std containers");
+  Serializer reference(endianness::big);
+  reference << std::string("AAPL") << std::vector<int32_t>{1, -2, 3}
+            << std::vector<std::string>{"XN", "ARCA"};
+  runner.check(reference.get_data() == data, "Encoding differs");
+  runner.check(validate<fixed_string<8>>(serialize(std::string("AAPL"))),
+               "Valid fixed_string rejected");
+
+  runner.start_test("fixed-capacity decode rejects oversized input");
+  auto long_string = serialize(std::string("TOO-LONG-SYMBOL"));
+  auto long_vector = serialize(std::vector<int32_t>{1, 2, 3, 4, 5});
+  runner.check(!validate<fixed_string<8>>(long_string) &&
+                   !validate<static_vector<int32_t, 4>>(long_vector),
+               "Oversized input validated");
+  bool string_threw = false, vector_threw = false;
+  try
+  {
+    Deserializer(long_string) >> symbol_out;
+  }
+  catch (const std::runtime_error &)
+  {
+    string_threw = true;
+  }
+  try
+  {
+    Deserializer(long_vector) >> levels_out;
+  }
+  catch (const std::runtime_error &)
+  {
+    vector_threw = true;
+  }
+  runner.check(string_threw && vector_threw, "Capacity not enforced");
+}
+
+void test_deque_and_list(test_runner &runner)
+{
+  // Enough elements, pushed at both ends, to span several deque blocks.
+  std::deque<double> history;
+  for (int i = 0; i < 1000; ++i)
+  {
+    history.push_back(i * 0.5);
+    history.push_front(-i * 0.25);
+  }
+  std::list<std::string> names = {"alpha", "beta", "gamma"};
+  std::deque<std::string> labels = {"x", "y"};
+  std::list<uint16_t> ports = {80, 443};
+
+  runner.start_test("deque and list round trip");
+  Serializer serializer(endianness::big);
+  serializer << history << names << labels << ports;
+  Deserializer deserializer(serializer.get_data(), endianness::big);
+  std::deque<double> history_out;
+  std::list<std::string> names_out;
+  std::deque<std::string> labels_out = {"stale"};
+  std::list<uint16_t> ports_out = {1};
+  deserializer >> history_out >> names_out >> labels_out >> ports_out;
+  runner.check(history_out == history && names_out == names &&
+                   labels_out == labels && ports_out == ports,
+               "Sequence round trip mismatch");
+
+  runner.start_test("deque encoding matches vector");
+  Serializer reference(endianness::big);
+  reference << std::vector<double>(history.begin(), history.end());
+  runner.check(serialize(history, endianness::big) ==
+                   reference.get_data(),
+               "Deque encoding differs from vector");
+  runner.check(validate<std::deque<double>>(reference.get_data(), endianness::big) &&
+                   validate<std::list<std::string>>(serialize(names)),
+               "Valid sequence rejected");
+
+  runner.start_test("deque skip and oversized count");
+  Deserializer skipper(serializer.get_data(), endianness::big);
+  skipper.skip<std::deque<double>>().skip<std::list<std::string>>();
+  std::deque<std::string> labels_skipped;
+  skipper >> labels_skipped;
+  runner.check(labels_skipped == labels, "Skip misaligned");
+  bool threw = false;
+  try
+  {
+    std::vector<uint8_t> huge = {0xFF, 0xFF, 0xFF, 0x7F};
+    std::deque<double> out;
+    Deserializer(huge) >> out;
+  }
+  catch (const std::runtime_error &)
+  {
+    threw = true;
+  }
+  runner.check(threw, "Oversized deque accepted");
+}
+
+void test_chrono_bitset_complex(test_runner &runner)
+{
+  using clock = std::chrono::system_clock;
+  using time_point = std::chrono::time_point<clock, std::chrono::microseconds>;
+  std::vector<time_point> ticks;
+  const time_point start(std::chrono::microseconds(1700000000000000));
+  for (int i = 0; i < 100; ++i)
+    ticks.push_back(start + std::chrono::microseconds(i * 250));
+  const std::chrono::milliseconds timeout(-1500);
+
+  runner.start_test("chrono round trip in every time encoding");
+  bool all_match = true;
+  std::array<size_t, 3> sizes{};
+  const time_encoding encodings[] = {time_encoding::fixed,
+                                     time_encoding::varint,
+                                     time_encoding::delta};
+  for (size_t e = 0; e < 3; ++e)
+  {
+    Serializer serializer(endianness::big);
+    serializer.set_time_encoding(encodings[e]);
+    serializer << ticks << timeout;
+    sizes[e] = serializer.get_data().size();
+
+    Deserializer deserializer(serializer.get_data(), endianness::big);
+    deserializer.set_time_encoding(encodings[e]);
+    std::vector<time_point> ticks_out;
+    std::chrono::milliseconds timeout_out;
+    deserializer >> ticks_out >> timeout_out;
+    all_match = all_match && ticks_out == ticks && timeout_out == timeout;
+  }
+  runner.check(all_match, "Chrono round trip mismatch");
+  runner.check(sizes[2] < sizes[1] && sizes[1] < sizes[0],
+               "Delta encoding not smaller than varint and fixed");
+
+  runner.start_test("bitset packs into words");
+  std::bitset<70> mask;
+  mask.set(0).set(63).set(64).set(69);
+  Serializer bit_serializer(endianness::little);
+  bit_serializer << mask;
+  auto bit_data = bit_serializer.get_data();
+  std::bitset<70> mask_out;
+  Deserializer(bit_data, endianness::little) >> mask_out;
+  runner.check(bit_data.size() == 16 && bit_data[0] == 0x01 &&
+                   bit_data[7] == 0x80 && bit_data[8] == 0x21 &&
+                   mask_out == mask,
+               "Bitset packing mismatch");
+  bit_data[15] = 0x80;
+  Deserializer strict(bit_data, endianness::little);
+  strict.set_canonical(true);
+  bool threw = false;
+  try
+  {
+    strict >> mask_out;
+  }
+  catch (const std::runtime_error &)
+  {
+    threw = true;
+  }
+  runner.check(threw, "Padding bits accepted in canonical mode");
+
+  runner.start_test("complex arrays use the float layout");
+  std::vector<std::complex<float>> iq = {{1.0f, -1.0f}, {0.5f, 0.25f}};
+  auto iq_data = serialize(iq, endianness::big);
+  Serializer flat(endianness::big);
+  flat << uint32_t(2) << 1.0f << -1.0f << 0.5f << 0.25f;
+  std::vector<std::complex<float>> iq_out;
+  std::complex<double> single_out;
+  Deserializer(iq_data, endianness::big) >> iq_out;
+  Deserializer(serialize(std::complex<double>(2.0, 3.0))) >> single_out;
+  runner.check(iq_data == flat.get_data() && iq_out == iq &&
+                   single_out == std::complex<double>(2.0, 3.0) &&
+                   validate<std::vector<std::complex<float>>>(iq_data, endianness::big),
+               "Complex encoding mismatch");
+}
+
+namespace geometry
+{
+
+struct vec3
+{
+  float x, y, z;
+
+  bool operator==(const vec3 &other) const
+  {
+    return x == other.x && y == other.y && z == other.z;
+  }
+};
+
+struct order_id
+{
+  uint32_t high;
+  uint16_t low;
+  uint16_t venue;
+
+  bool operator==(const order_id &other) const
+  {
+    return high == other.high && low == other.low && venue == other.venue;
+  }
+};
+
+struct label
+{
+  std::string text;
+  vec3 anchor;
+};
+
+void serialize(Serializer &serializer, const label &value)
+{
+  serializer << value.text << value.anchor;
+}
+
+void deserialize(Deserializer &deserializer, label &value)
+{
+  deserializer >> value.text >> value.anchor;
+}
+
+} // namespace geometry
+
+namespace binary_serializer
+{
+template <> struct is_trivially_serializable<geometry::vec3> : std::true_type
+{
+  using element_type = float;
+};
+template <>
+struct is_trivially_serializable<geometry::order_id> : std::true_type
+{
+};
+}
+
+void test_user_type_extension(test_runner &runner)
+{
+  using geometry::vec3;
+  std::vector<vec3> points = {{1, 2, 3}, {-4, 5.5f, 6}};
+
+  runner.start_test("trivially serializable vectors in both byte orders");
+  bool all_match = true;
+  for (auto endian : {endianness::little, endianness::big})
+  {
+    Serializer flat(endian);
+    flat << uint32_t(2) << 1.0f << 2.0f << 3.0f << -4.0f << 5.5f << 6.0f;
+    auto data = serialize(points, endian);
+    all_match = all_match && data == flat.get_data() &&
+                deserialize<std::vector<vec3>>(data, endian) == points &&
+                validate<std::vector<vec3>>(data, endian);
+  }
+  runner.check(all_match, "Trivial bulk encoding mismatch");
+
+  runner.start_test("empty trivially serializable vectors");
+  const std::vector<geometry::order_id> no_ids;
+  runner.check(deserialize<std::vector<vec3>>(
+                   serialize(std::vector<vec3>{}, endianness::big),
+                   endianness::big)
+                       .empty() &&
+                   deserialize<std::vector<geometry::order_id>>(
+                       serialize(no_ids))
+                       .empty(),
+               "Empty trivial vector did not round trip");
+
+  runner.start_test("trivial type without element type needs native order");
+  std::array<geometry::order_id, 2> ids = {
+      geometry::order_id{7, 1, 2}, geometry::order_id{8, 3, 4}};
+  auto native = serialize(ids);
+  runner.check(native.size() == 4 + 2 * sizeof(geometry::order_id) &&
+                   deserialize<std::array<geometry::order_id, 2>>(native) ==
+                       ids,
+               "Native trivial round trip mismatch");
+  const auto foreign = get_system_endianness() == endianness::little
+                           ? endianness::big
+                           : endianness::little;
+  bool threw = false;
+  try
+  {
+    serialize(ids, foreign);
+  }
+  catch (const std::runtime_error &)
+  {
+    threw = true;
+  }
+  runner.check(threw, "Foreign byte order accepted without element type");
+
+  runner.start_test("ADL and member serialize extension points");
+  std::vector<geometry::label> labels = {{"origin", {0, 0, 0}},
+                                         {"tip", {1, 1, 1}}};
+  auto label_data = serialize(labels, endianness::big);
+  auto labels_out =
+      deserialize<std::vector<geometry::label>>(label_data, endianness::big);
+  circle c;
+  c.radius = 1.5;
+  circle c_out;
+  Deserializer(serialize(c)) >> c_out;
+  runner.check(labels_out.size() == 2 && labels_out[1].text == "tip" &&
+                   labels_out[1].anchor == labels[1].anchor &&
+                   c_out.radius == 1.5,
+               "User type round trip mismatch");
+}
+
+void test_arrow_interface(test_runner &runner)
+{
+  Schema schema;
+  schema.add("id", field_type::uint32)
+      .add("price", field_type::float64)
+      .add("active", field_type::boolean)
+      .add("symbol", field_type::string);
+  Serializer records(endianness::big);
+  for (uint32_t i = 0; i < 10; ++i)
+  {
+    records << i << i * 1.5 << (i % 3 == 0) << ("S" + std::to_string(i));
+  }
+  auto data = records.get_data();
+
+  runner.start_test("records decode into columns");
+  auto batch = ColumnBatch::from_records(data, schema, endianness::big);
+  runner.check(batch.num_rows() == 10 && batch.values<uint32_t>(0)[7] == 7 &&
+                   batch.values<double>(1)[4] == 6.0 && batch.bool_at(2, 9) &&
+                   !batch.bool_at(2, 8) && batch.string_at(3, 9) == "S9",
+               "Column decode mismatch");
+
+  runner.start_test("column decode rolls back a failed record");
+  Schema pair_schema;
+  pair_schema.add("a", field_type::int32)
+      .add("flag", field_type::boolean)
+      .add("b", field_type::string);
+  Serializer partial;
+  partial << int32_t(5) << true;
+  auto partial_data = partial.get_data();
+  ColumnBatch pairs(pair_schema);
+  bool partial_threw = false;
+  try
+  {
+    pairs.append_records(partial_data);
+  }
+  catch (const std::runtime_error &)
+  {
+    partial_threw = true;
+  }
+  Serializer complete;
+  complete << int32_t(1) << false << std::string("ok");
+  pairs.append_records(complete.get_data());
+  runner.check(partial_threw && pairs.num_rows() == 1 &&
+                   pairs.values<int32_t>(0)[0] == 1 && !pairs.bool_at(1, 0) &&
+                   pairs.string_at(2, 0) == "ok" &&
+                   pairs.to_records() == complete.get_data(),
+               "Columns misaligned after failed record");
+  bool wrong_type_threw = false;
+  try
+  {
+    batch.values<int32_t>(0);
+  }
+  catch (const std::invalid_argument &)
+  {
+    wrong_type_threw = true;
+  }
+  runner.check(wrong_type_threw, "values<T> accepted a mismatched type");
+
+  runner.start_test("Arrow export points at batch storage");
+  ArrowArray array;
+  ArrowSchema arrow_schema;
+  batch.export_to(&array, &arrow_schema);
+  runner.check(std::string_view(arrow_schema.format) == "+s" &&
+                   arrow_schema.n_children == 4 &&
+                   std::string_view(arrow_schema.children[3]->format) == "u" &&
+                   std::string_view(arrow_schema.children[1]->name) ==
+                       "price" &&
+                   array.length == 10 && array.children[0]->n_buffers == 2 &&
+                   array.children[0]->buffers[1] == batch.values<uint32_t>(0),
+               "Export layout mismatch");
+
+  runner.start_test("Arrow import round trip and release");
+  ColumnBatch appended = batch;
+  appended.append_records(data, endianness::big);
+  auto imported = ColumnBatch::import_from(&array, &arrow_schema);
+  runner.check(array.release == nullptr && arrow_schema.release == nullptr,
+               "Import did not release inputs");
+  runner.check(imported.num_rows() == 10 && appended.num_rows() == 20 &&
+                   batch.num_rows() == 10 &&
+                   imported.to_records(endianness::big) == data,
+               "Import round trip mismatch");
+
+  runner.start_test("Arrow import rejects missing buffers");
+  ArrowArray broken;
+  ArrowSchema broken_schema;
+  batch.export_to(&broken, &broken_schema);
+  broken.children[0]->buffers[1] = nullptr;
+  bool broken_threw = false;
+  try
+  {
+    ColumnBatch::import_from(&broken, &broken_schema);
+  }
+  catch (const std::invalid_argument &)
+  {
+    broken_threw = true;
+  }
+  runner.check(broken_threw && broken.release == nullptr,
+               "Missing buffer accepted");
+
+  runner.start_test("Arrow export outlives its batch");
+  ArrowArray survivor;
+  ArrowSchema survivor_schema;
+  {
+    ColumnBatch temporary = ColumnBatch::from_records(data, schema,
+                                                      endianness::big);
+    temporary.export_to(&survivor, &survivor_schema);
+  }
+  const auto *offsets =
+      static_cast<const int32_t *>(survivor.children[3]->buffers[1]);
+  const auto *chars =
+      static_cast<const char *>(survivor.children[3]->buffers[2]);
+  runner.check(std::string_view(chars + offsets[2], offsets[3] - offsets[2]) ==
+                   "S2",
+               "Exported buffers freed with the batch");
+  survivor.release(&survivor);
+  survivor_schema.release(&survivor_schema);
+
+  runner.start_test("Arrow batch rejects empty schema");
+  try
+  {
+    ColumnBatch::from_records(std::vector<uint8_t>{1}, Schema());
+    runner.check(false, "Should have thrown exception");
+  }
+  catch (const std::invalid_argument &)
+  {
+    runner.check(true);
+  }
+}
+
+void test_npy_files(test_runner &runner)
+{
+  std::vector<float> matrix(12);
+  std::iota(matrix.begin(), matrix.end(), 0.5f);
+
+  runner.start_test("npy header layout");
+  auto image = to_npy(matrix.data(), {3, 4}, endianness::little);
+  const std::string_view dict(reinterpret_cast<const char *>(image.data()) + 10,
+                              image.size() - 10 - matrix.size() * 4);
+  runner.check(image[0] == 0x93 && image[6] == 1 &&
+                   (image.size() - 48) % 64 == 0 &&
+                   dict.substr(0, 56) == "{'descr': '<f4', 'fortran_order': "
+                                         "False, 'shape': (3, 4)" &&
+                   dict.back() == '\n',
+               "npy header mismatch");
+
+  runner.start_test("npy round trip in both byte orders");
+  std::vector<size_t> shape;
+  auto decoded = from_npy<float>(image, &shape);
+  auto big = to_npy(std::vector<int64_t>{-1, 2, 3}, endianness::big);
+  auto header = read_npy_header(big);
+  runner.check(decoded == matrix && shape == std::vector<size_t>{3, 4} &&
+                   from_npy<int64_t>(big) == std::vector<int64_t>{-1, 2, 3} &&
+                   header.byte_order == endianness::big &&
+                   header.shape == std::vector<size_t>{3},
+               "npy round trip mismatch");
+  bool threw = false;
+  try
+  {
+    from_npy<double>(image);
+  }
+  catch (const std::runtime_error &)
+  {
+    threw = true;
+  }
+  runner.check(threw, "Mismatched dtype accepted");
+
+  runner.start_test("npy rejects Fortran order and bad header numbers");
+  auto fortran = to_npy(std::vector<int32_t>{1, 2, 3, 4, 5, 6});
+  const std::string c_text = "'fortran_order': False, 'shape': (6,), ";
+  const std::string f_text = "'fortran_order': True, 'shape': (2, 3), ";
+  auto at = std::search(fortran.begin(), fortran.end(), c_text.begin(),
+                        c_text.end());
+  std::copy(f_text.begin(), f_text.end(), at);
+  bool fortran_threw = false;
+  try
+  {
+    from_npy<int32_t>(fortran);
+  }
+  catch (const std::runtime_error &)
+  {
+    fortran_threw = true;
+  }
+  std::vector<size_t> fortran_shape;
+  auto column_major = from_npy<int32_t>(fortran, &fortran_shape, true);
+  runner.check(fortran_threw && column_major[1] == 2 &&
+                   fortran_shape == std::vector<size_t>{2, 3} &&
+                   read_npy_header(fortran).fortran_order,
+               "Fortran-order array not flagged");
+
+  auto bad_dtype = to_npy(std::vector<int32_t>{1});
+  const std::string dtype = "'<i4'";
+  auto dtype_at = std::search(bad_dtype.begin(), bad_dtype.end(),
+                              dtype.begin(), dtype.end());
+  dtype_at[3] = 'x';
+  auto huge_dim = to_npy(std::vector<int32_t>{1});
+  const std::string dim = "(1,)";
+  auto dim_at =
+      std::search(huge_dim.begin(), huge_dim.end(), dim.begin(), dim.end());
+  // Overwrites the padding, so the header length stays valid.
+  const std::string huge = "(99999999999999999999999,), }";
+  std::copy(huge.begin(), huge.end(), dim_at);
+  size_t header_errors = 0;
+  for (const auto &image_bytes : {bad_dtype, huge_dim})
+  {
+    try
+    {
+      read_npy_header(image_bytes);
+    }
+    catch (const std::runtime_error &)
+    {
+      ++header_errors;
+    }
+  }
+  runner.check(header_errors == 2, "Malformed header numbers not rejected");
+
+  runner.start_test("mapped npy gives zero-copy access");
+  const std::string path = "crux_msg_test_matrix.npy";
+  write_npy_file(path, to_npy(matrix.data(), {3, 4}));
+  {
+    MappedNpy mapped(path);
+    const float *values = mapped.data<float>();
+    runner.check(mapped.shape() == std::vector<size_t>{3, 4} &&
+                     mapped.count() == 12 && values[11] == matrix[11] &&
+                     reinterpret_cast<uintptr_t>(values) % 64 == 0 &&
+                     mapped.to_vector<float>() == matrix,
+                 "Mapped npy mismatch");
+  }
+  std::remove(path.c_str());
+}
+
 int main()
 {
   test_runner runner;
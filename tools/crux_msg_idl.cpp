@@ -0,0 +1,730 @@
+// Schema compiler: reads a .idl file of struct definitions and writes a C++
+// header with the structs plus specialized encode/decode/encoded_size
+// functions built on binary_serializer::Buffer. The output is wire
+// compatible with Serializer/Deserializer.
+//
+//   namespace market;
+//   struct Quote {
+//     u32 id;
+//     f64 bid;
+//     string symbol;
+//     vector<i16> levels;
+//     u8[4] flags;
+//   }
+//
+// Scalars: bool i8 u8 i16 u16 i32 u32 i64 u64 f32 f64. Also string,
+// vector<T> (T scalar, string or an earlier struct), T[N] (T scalar) and
+// earlier structs by name. Comments start with # or //.
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct scalar_info
+{
+  const char *cpp_type;
+  size_t size;
+};
+
+const std::map<std::string, scalar_info> scalars = {
+    {"bool", {"bool", 1}},       {"i8", {"int8_t", 1}},
+    {"u8", {"uint8_t", 1}},      {"i16", {"int16_t", 2}},
+    {"u16", {"uint16_t", 2}},    {"i32", {"int32_t", 4}},
+    {"u32", {"uint32_t", 4}},    {"i64", {"int64_t", 8}},
+    {"u64", {"uint64_t", 8}},    {"f32", {"float", 4}},
+    {"f64", {"double", 8}},
+};
+
+enum class kind
+{
+  scalar,
+  string,
+  message,
+  vector,
+  array
+};
+
+struct field_def
+{
+  std::string name;
+  kind type;
+  // Scalar or message name of the field (scalar/message) or its elements
+  // (vector/array).
+  std::string element;
+  kind element_type = kind::scalar;
+  size_t count = 0;
+};
+
+struct message_def
+{
+  std::string name;
+  std::vector<field_def> fields;
+  size_t static_size = 0;
+  bool fixed_size = true;
+};
+
+class compile_error : public std::runtime_error
+{
+public:
+  compile_error(int line, const std::string &message)
+      : std::runtime_error(std::to_string(line) + ": " + message)
+  {}
+};
+
+struct token
+{
+  std::string text;
+  int line;
+};
+
+std::vector<token> tokenize(const std::string &source)
+{
+  std::vector<token> tokens;
+  int line = 1;
+  size_t i = 0;
+  while (i < source.size())
+  {
+    const char c = source[i];
+    if (c == '\n')
+    {
+      ++line;
+      ++i;
+    }
+    else if (std::isspace(static_cast<unsigned char>(c)))
+    {
+      ++i;
+    }
+    else if (c == '#' || source.compare(i, 2, "//") == 0)
+    {
+      while (i < source.size() && source[i] != '\n')
+        ++i;
+    }
+    else if (std::isalnum(static_cast<unsigned char>(c)) || c == '_')
+    {
+      size_t start = i;
+      while (i < source.size() &&
+             (std::isalnum(static_cast<unsigned char>(source[i])) ||
+              source[i] == '_' || source[i] == ':'))
+        ++i;
+      tokens.push_back(token{source.substr(start, i - start), line});
+    }
+    else if (std::string("{}<>[];").find(c) != std::string::npos)
+    {
+      tokens.push_back(token{std::string(1, c), line});
+      ++i;
+    }
+    else
+    {
+      throw compile_error(line, std::string("unexpected character '") + c +
+                                    "'");
+    }
+  }
+  return tokens;
+}
+
+class parser
+{
+private:
+  std::vector<token> m_tokens;
+  size_t m_pos = 0;
+  std::vector<message_def> m_messages;
+  std::string m_namespace;
+
+public:
+  explicit parser(std::vector<token> tokens) : m_tokens(std::move(tokens))
+  {}
+
+  void parse()
+  {
+    while (m_pos < m_tokens.size())
+    {
+      const token &keyword = next();
+      if (keyword.text == "namespace")
+      {
+        m_namespace = identifier();
+        expect(";");
+      }
+      else if (keyword.text == "struct")
+      {
+        parse_struct();
+      }
+      else
+      {
+        throw compile_error(keyword.line,
+                            "expected 'struct' or 'namespace', got '" +
+                                keyword.text + "'");
+      }
+    }
+  }
+
+  const std::vector<message_def> &messages() const
+  {
+    return m_messages;
+  }
+  const std::string &name_space() const
+  {
+    return m_namespace;
+  }
+
+private:
+  const token &peek() const
+  {
+    if (m_pos >= m_tokens.size())
+    {
+      const int line = m_tokens.empty() ? 1 : m_tokens.back().line;
+      throw compile_error(line, "unexpected end of file");
+    }
+    return m_tokens[m_pos];
+  }
+
+  const token &next()
+  {
+    const token &current = peek();
+    ++m_pos;
+    return current;
+  }
+
+  bool accept(const char *text)
+  {
+    if (m_pos < m_tokens.size() && m_tokens[m_pos].text == text)
+    {
+      ++m_pos;
+      return true;
+    }
+    return false;
+  }
+
+  void expect(const char *text)
+  {
+    const token &current = next();
+    if (current.text != text)
+    {
+      throw compile_error(current.line, std::string("expected '") + text +
+                                            "', got '" + current.text + "'");
+    }
+  }
+
+  std::string identifier()
+  {
+    const token &current = next();
+    if (!std::isalpha(static_cast<unsigned char>(current.text[0])) &&
+        current.text[0] != '_')
+    {
+      throw compile_error(current.line,
+                          "expected identifier, got '" + current.text + "'");
+    }
+    return current.text;
+  }
+
+  const message_def *find_message(const std::string &name) const
+  {
+    for (const auto &message : m_messages)
+    {
+      if (message.name == name)
+        return &message;
+    }
+    return nullptr;
+  }
+
+  void parse_struct()
+  {
+    message_def message;
+    const int line = peek().line;
+    message.name = identifier();
+    if (find_message(message.name) || scalars.count(message.name))
+    {
+      throw compile_error(line, "duplicate type '" + message.name + "'");
+    }
+
+    expect("{");
+    while (!accept("}"))
+    {
+      const int field_line = peek().line;
+      field_def field = parse_type();
+      field.name = identifier();
+      expect(";");
+      for (const auto &existing : message.fields)
+      {
+        if (existing.name == field.name)
+        {
+          throw compile_error(field_line,
+                              "duplicate field '" + field.name + "'");
+        }
+      }
+      add_size(message, field);
+      message.fields.push_back(std::move(field));
+    }
+    accept(";");
+    m_messages.push_back(std::move(message));
+  }
+
+  field_def parse_type()
+  {
+    const token &name = next();
+    field_def field;
+    if (name.text == "string")
+    {
+      field.type = kind::string;
+    }
+    else if (name.text == "vector")
+    {
+      expect("<");
+      const token &element = next();
+      field.type = kind::vector;
+      field.element = element.text;
+      field.element_type = element_kind(element);
+      if (element.text == "bool")
+      {
+        throw compile_error(element.line, "vector<bool> is not supported");
+      }
+      expect(">");
+    }
+    else
+    {
+      field.element = name.text;
+      field.type = element_kind(name);
+      field.element_type = field.type;
+      if (accept("["))
+      {
+        const token &count = next();
+        if (field.type != kind::scalar)
+        {
+          throw compile_error(count.line, "arrays must hold scalars");
+        }
+        try
+        {
+          field.count = std::stoul(count.text);
+        }
+        catch (const std::exception &)
+        {
+          throw compile_error(count.line, "invalid array size");
+        }
+        field.type = kind::array;
+        field.element_type = kind::scalar;
+        expect("]");
+      }
+    }
+    return field;
+  }
+
+  kind element_kind(const token &name) const
+  {
+    if (scalars.count(name.text))
+      return kind::scalar;
+    if (name.text == "string")
+      return kind::string;
+    if (find_message(name.text))
+      return kind::message;
+    throw compile_error(name.line, "unknown type '" + name.text + "'");
+  }
+
+  void add_size(message_def &message, const field_def &field) const
+  {
+    switch (field.type)
+    {
+    case kind::scalar:
+      message.static_size += scalars.at(field.element).size;
+      break;
+    case kind::array:
+      message.static_size += 4 + field.count * scalars.at(field.element).size;
+      break;
+    case kind::string:
+    case kind::vector:
+      message.static_size += 4;
+      message.fixed_size = false;
+      break;
+    case kind::message:
+    {
+      const message_def *nested = find_message(field.element);
+      message.static_size += nested->static_size;
+      message.fixed_size = message.fixed_size && nested->fixed_size;
+      break;
+    }
+    }
+  }
+};
+
+// Coalesced runs are staged in a stack array, so runs are split at this size
+// and larger arrays are written with write_bulk/read_bulk instead.
+constexpr size_t max_block_size = 256;
+
+size_t packed_size(const field_def &field)
+{
+  const size_t width = scalars.at(field.element).size;
+  return field.type == kind::array ? 4 + field.count * width : width;
+}
+
+bool coalesced(const field_def &field)
+{
+  return field.type == kind::scalar ||
+         (field.type == kind::array && packed_size(field) <= max_block_size);
+}
+
+std::string element_cpp_type(const field_def &field)
+{
+  if (field.element_type == kind::scalar)
+    return scalars.at(field.element).cpp_type;
+  if (field.element_type == kind::string)
+    return "std::string";
+  return field.element;
+}
+
+std::string field_cpp_type(const field_def &field)
+{
+  switch (field.type)
+  {
+  case kind::scalar:
+  case kind::message:
+    return element_cpp_type(field);
+  case kind::string:
+    return "std::string";
+  case kind::vector:
+    return "std::vector<" + element_cpp_type(field) + ">";
+  case kind::array:
+    return "std::array<" + element_cpp_type(field) + ", " +
+           std::to_string(field.count) + ">";
+  }
+  return "";
+}
+
+// Runs of consecutive scalar/array fields are written through one stack
+// block and a single write_bytes call.
+struct block
+{
+  size_t first;
+  size_t last;
+  size_t size;
+};
+
+std::vector<block> find_blocks(const message_def &message)
+{
+  std::vector<block> blocks;
+  for (size_t i = 0; i < message.fields.size(); ++i)
+  {
+    if (!coalesced(message.fields[i]))
+      continue;
+    block current{i, i, 0};
+    while (current.last < message.fields.size() &&
+           coalesced(message.fields[current.last]))
+    {
+      const size_t size = packed_size(message.fields[current.last]);
+      if (current.size + size > max_block_size)
+        break;
+      current.size += size;
+      ++current.last;
+    }
+    i = current.last - 1;
+    blocks.push_back(current);
+  }
+  return blocks;
+}
+
+void emit_struct(std::ostream &out, const message_def &message)
+{
+  out << "struct " << message.name << "\n{\n";
+  for (const auto &field : message.fields)
+  {
+    out << "  " << field_cpp_type(field) << " " << field.name << "{};\n";
+  }
+  out << "\n  static constexpr size_t static_size = " << message.static_size
+      << ";\n";
+  out << "  static constexpr bool is_fixed_size = "
+      << (message.fixed_size ? "true" : "false") << ";\n";
+  out << "};\n\n";
+}
+
+void emit_encoded_size(std::ostream &out, const message_def &message)
+{
+  out << "inline size_t encoded_size(const " << message.name
+      << " &value)\n{\n";
+  if (message.fixed_size)
+  {
+    out << "  (void)value;\n  return " << message.name << "::static_size;\n}\n\n";
+    return;
+  }
+
+  out << "  size_t size = " << message.name << "::static_size;\n";
+  for (const auto &field : message.fields)
+  {
+    const std::string member = "value." + field.name;
+    if (field.type == kind::string)
+    {
+      out << "  size += " << member << ".size();\n";
+    }
+    else if (field.type == kind::message)
+    {
+      out << "  size += encoded_size(" << member << ") - " << field.element
+          << "::static_size;\n";
+    }
+    else if (field.type == kind::vector)
+    {
+      if (field.element_type == kind::scalar)
+      {
+        out << "  size += " << member << ".size() * "
+            << scalars.at(field.element).size << ";\n";
+      }
+      else
+      {
+        out << "  for (const auto &element : " << member << ")\n";
+        out << "    size += "
+            << (field.element_type == kind::string ? "4 + element.size()"
+                                                   : "encoded_size(element)")
+            << ";\n";
+      }
+    }
+  }
+  out << "  return size;\n}\n\n";
+}
+
+// encode() reserves room for the whole message once, growing the buffer
+// geometrically so appending many messages stays linear; nested messages
+// and elements go through encode_fields() and never reserve.
+void emit_encode(std::ostream &out, const message_def &message,
+                 const std::vector<block> &blocks)
+{
+  out << "inline void encode_fields(binary_serializer::Buffer &out, const "
+      << message.name << " &value)\n{\n";
+  if (!blocks.empty())
+  {
+    out << "  const bool swap =\n      out.get_endianness() != "
+           "binary_serializer::get_system_endianness();\n";
+  }
+
+  size_t next_block = 0;
+  for (size_t i = 0; i < message.fields.size(); ++i)
+  {
+    const field_def &field = message.fields[i];
+    const std::string member = "value." + field.name;
+    if (next_block < blocks.size() && blocks[next_block].first == i)
+    {
+      const block &current = blocks[next_block++];
+      out << "  {\n    uint8_t block[" << current.size << "];\n";
+      size_t offset = 0;
+      for (size_t j = current.first; j < current.last; ++j)
+      {
+        const field_def &packed = message.fields[j];
+        const scalar_info &info = scalars.at(packed.element);
+        const std::string packed_member = "value." + packed.name;
+        if (packed.type == kind::scalar)
+        {
+          out << "    binary_serializer::store_value(block + " << offset
+              << ", " << packed_member << ", swap);\n";
+          offset += info.size;
+          continue;
+        }
+        out << "    binary_serializer::store_value<uint32_t>(block + " << offset
+            << ", " << packed.count << ", swap);\n";
+        out << "    for (size_t i = 0; i < " << packed.count << "; ++i)\n";
+        out << "      binary_serializer::store_value(block + "
+            << offset + 4 << " + i * " << info.size << ", " << packed_member
+            << "[i], swap);\n";
+        offset += 4 + packed.count * info.size;
+      }
+      out << "    out.write_bytes(block, sizeof(block));\n  }\n";
+      i = current.last - 1;
+      continue;
+    }
+
+    if (field.type == kind::string)
+    {
+      out << "  out.write_string(" << member << ");\n";
+    }
+    else if (field.type == kind::message)
+    {
+      out << "  encode_fields(out, " << member << ");\n";
+    }
+    else if (field.type == kind::array)
+    {
+      out << "  out.write_array(" << member << ".data(), " << field.count
+          << ");\n";
+    }
+    else if (field.element_type == kind::scalar)
+    {
+      out << "  out.write_array(" << member << ".data(), " << member
+          << ".size());\n";
+    }
+    else
+    {
+      out << "  out.write<uint32_t>(static_cast<uint32_t>(" << member
+          << ".size()));\n";
+      out << "  for (const auto &element : " << member << ")\n";
+      out << (field.element_type == kind::string
+                  ? "    out.write_string(element);\n"
+                  : "    encode_fields(out, element);\n");
+    }
+  }
+  out << "}\n\n";
+
+  out << "inline void encode(binary_serializer::Buffer &out, const "
+      << message.name << " &value)\n{\n";
+  out << "  const size_t need = out.size() + encoded_size(value);\n";
+  out << "  if (need > out.capacity())\n";
+  out << "    out.reserve(std::max(need, 2 * out.capacity()));\n";
+  out << "  encode_fields(out, value);\n}\n\n";
+}
+
+void emit_decode(std::ostream &out, const message_def &message,
+                 const std::vector<block> &blocks)
+{
+  out << "inline void decode(binary_serializer::Buffer &in, " << message.name
+      << " &value)\n{\n";
+  if (!blocks.empty())
+  {
+    out << "  const bool swap =\n      in.get_endianness() != "
+           "binary_serializer::get_system_endianness();\n";
+  }
+
+  size_t next_block = 0;
+  for (size_t i = 0; i < message.fields.size(); ++i)
+  {
+    const field_def &field = message.fields[i];
+    const std::string member = "value." + field.name;
+    if (next_block < blocks.size() && blocks[next_block].first == i)
+    {
+      const block &current = blocks[next_block++];
+      out << "  {\n    const uint8_t *block = in.read_bytes(" << current.size
+          << ");\n";
+      size_t offset = 0;
+      for (size_t j = current.first; j < current.last; ++j)
+      {
+        const field_def &packed = message.fields[j];
+        const scalar_info &info = scalars.at(packed.element);
+        const std::string packed_member = "value." + packed.name;
+        if (packed.type == kind::scalar)
+        {
+          out << "    " << packed_member << " = binary_serializer::load_value<"
+              << info.cpp_type << ">(block + " << offset << ", swap);\n";
+          offset += info.size;
+          continue;
+        }
+        out << "    if (binary_serializer::load_value<uint32_t>(block + "
+            << offset << ", swap) != " << packed.count << ")\n";
+        out << "      throw std::runtime_error(\"Array size mismatch\");\n";
+        out << "    for (size_t i = 0; i < " << packed.count << "; ++i)\n";
+        out << "      " << packed_member << "[i] = binary_serializer::load_value<"
+            << info.cpp_type << ">(block + " << offset + 4 << " + i * "
+            << info.size << ", swap);\n";
+        offset += 4 + packed.count * info.size;
+      }
+      out << "  }\n";
+      i = current.last - 1;
+      continue;
+    }
+
+    if (field.type == kind::string)
+    {
+      out << "  " << member << " = in.read_string();\n";
+    }
+    else if (field.type == kind::message)
+    {
+      out << "  decode(in, " << member << ");\n";
+    }
+    else if (field.type == kind::array)
+    {
+      out << "  if (in.read<uint32_t>() != " << field.count << ")\n";
+      out << "    throw std::runtime_error(\"Array size mismatch\");\n";
+      out << "  in.read_bulk(" << member << ".data(), " << field.count
+          << ");\n";
+    }
+    else if (field.element_type == kind::scalar)
+    {
+      out << "  " << member << " = in.read_array<" << element_cpp_type(field)
+          << ">();\n";
+    }
+    else
+    {
+      out << "  {\n    const uint32_t count = in.read<uint32_t>();\n";
+      out << "    if (count > in.size() - in.position())\n";
+      out << "      throw std::runtime_error(\"Vector extends beyond "
+             "buffer\");\n";
+      out << "    " << member << ".resize(count);\n";
+      out << "    for (auto &element : " << member << ")\n";
+      out << (field.element_type == kind::string
+                  ? "      element = in.read_string();\n"
+                  : "      decode(in, element);\n");
+      out << "  }\n";
+    }
+  }
+  out << "}\n\n";
+}
+
+void emit_header(std::ostream &out, const parser &schema,
+                 const std::string &source_name)
+{
+  out << "// Generated by crux_msg_idl from " << source_name
+      << ". Do not edit.\n";
+  out << "#pragma once\n\n";
+  out << "#include <binary_serializer/binary_serializer.hpp>\n\n";
+  out << "#include <algorithm>\n#include <array>\n#include <cstdint>\n"
+         "#include <stdexcept>\n#include <string>\n#include <vector>\n\n";
+  if (!schema.name_space().empty())
+  {
+    out << "namespace " << schema.name_space() << "\n{\n\n";
+  }
+  for (const auto &message : schema.messages())
+  {
+    const auto blocks = find_blocks(message);
+    emit_struct(out, message);
+    emit_encoded_size(out, message);
+    emit_encode(out, message, blocks);
+    emit_decode(out, message, blocks);
+  }
+  if (!schema.name_space().empty())
+  {
+    out << "}\n";
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc != 3)
+  {
+    std::cerr << "usage: " << argv[0] << " <schema.idl> <output.hpp>"
+              << std::endl;
+    return 2;
+  }
+
+  std::ifstream input(argv[1]);
+  if (!input)
+  {
+    std::cerr << argv[1] << ": cannot open file" << std::endl;
+    return 1;
+  }
+  std::stringstream source;
+  source << input.rdbuf();
+
+  std::ostringstream header;
+  try
+  {
+    parser schema(tokenize(source.str()));
+    schema.parse();
+    std::string source_name = argv[1];
+    const size_t slash = source_name.find_last_of("/\\");
+    if (slash != std::string::npos)
+      source_name = source_name.substr(slash + 1);
+    emit_header(header, schema, source_name);
+  }
+  catch (const compile_error &error)
+  {
+    std::cerr << argv[1] << ":" << error.what() << std::endl;
+    return 1;
+  }
+
+  std::ofstream output(argv[2]);
+  if (!output || !(output << header.str()))
+  {
+    std::cerr << argv[2] << ": cannot write file" << std::endl;
+    return 1;
+  }
+  return 0;
+}